@@ -0,0 +1,74 @@
+#include "core/args.h"
+
+#include <cerrno>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+bool parseInt(const char *text, int &value)
+{
+    char *end = nullptr;
+    errno = 0;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || v < INT_MIN || v > INT_MAX)
+        return false;
+    value = (int)v;
+    return true;
+}
+
+// strtoull 会把 "-1" 转成最大值，所以先排除负号
+static bool parseUnsignedLong(const char *text, unsigned long long max_value, unsigned long long &value)
+{
+    if (strchr(text, '-'))
+        return false;
+    char *end = nullptr;
+    errno = 0;
+    unsigned long long v = strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || v > max_value)
+        return false;
+    value = v;
+    return true;
+}
+
+bool parseUnsigned(const char *text, unsigned &value)
+{
+    unsigned long long v;
+    if (!parseUnsignedLong(text, UINT_MAX, v))
+        return false;
+    value = (unsigned)v;
+    return true;
+}
+
+bool parseSize(const char *text, size_t &value)
+{
+    unsigned long long v;
+    if (!parseUnsignedLong(text, SIZE_MAX, v))
+        return false;
+    value = (size_t)v;
+    return true;
+}
+
+bool parseDouble(const char *text, double &value)
+{
+    char *end = nullptr;
+    errno = 0;
+    double v = strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !isfinite(v))
+        return false;
+    value = v;
+    return true;
+}
+
+bool parseFloat(const char *text, float &value)
+{
+    double v;
+    if (!parseDouble(text, v) || fabs(v) > FLT_MAX)
+        return false;
+    value = (float)v;
+    return true;
+}
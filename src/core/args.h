@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+// 命令行数值参数的严格解析：整个字符串都必须是合法的数值且在类型范围内，
+// 否则返回 false 且不修改 value，由调用方打印用法后退出（std::stoi 等会抛出未捕获的异常）
+bool parseInt(const char *text, int &value);
+bool parseUnsigned(const char *text, unsigned &value); // 不接受负号
+bool parseSize(const char *text, size_t &value);       // 不接受负号
+bool parseDouble(const char *text, double &value);     // 不接受 inf / nan
+bool parseFloat(const char *text, float &value);
@@ -0,0 +1,534 @@
+#include "core/async_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+#ifdef DIGITS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "core/bmp.h"
+#include "core/metrics.h"
+using namespace std;
+
+const size_t worker_batch = 8;         // 线程池中每个线程一次最多取走的操作数
+const size_t bmp_buffer = 4096;        // 训练图片为 1862 字节，一次 read 即可读完
+const size_t max_bmp_file = 64 * 1024; // 28x28 的 BMP 远小于此；更大的文件不读完，直接拒绝
+const size_t window_factor = 4;        // 已读未交付的图片最多为协程数的这么多倍
+
+// 与 readBMP 共用同一个计数器（按名字注册）
+static Counter &decodeFailures()
+{
+    static Counter &c = metrics().counter("digits_decode_failures_total", "BMP files that could not be opened or parsed");
+    return c;
+}
+
+bool parseIoBackend(const string &text, IoBackend &backend)
+{
+    if (text == "auto")
+        backend = IoBackend::Auto;
+    else if (text == "uring")
+        backend = IoBackend::IoUring;
+    else if (text == "threads")
+        backend = IoBackend::Threads;
+    else
+        return false;
+    return true;
+}
+
+struct IoLoop::Engine
+{
+    virtual ~Engine() = default;
+    virtual const char *name() const = 0;
+    // 从 ops 开头起接收尽可能多的操作，返回接收的个数
+    virtual size_t submit(IoOp *const *ops, size_t count) = 0;
+    // 把已完成的操作追加到 done；wait 为真时至少等到一个
+    virtual void reap(vector<IoOp *> &done, bool wait) = 0;
+};
+
+// 线程池后端：在工作线程中执行阻塞的系统调用
+static void execute(IoOp &op)
+{
+    long r = 0;
+    switch (op.kind)
+    {
+    case IoOp::Kind::Open:
+        r = ::open(op.path, O_RDONLY | O_CLOEXEC);
+        break;
+    case IoOp::Kind::Read:
+        r = pread(op.fd, op.buf, op.len, op.offset);
+        break;
+    case IoOp::Kind::Close:
+        r = ::close(op.fd);
+        break;
+    }
+    op.result = r < 0 ? -errno : (int)r;
+}
+
+class ThreadEngine : public IoLoop::Engine
+{
+public:
+    explicit ThreadEngine(unsigned threads)
+    {
+        for (unsigned t = 0; t < threads; t++)
+            workers_.emplace_back([this]
+                                  { work(); });
+    }
+
+    ~ThreadEngine() override
+    {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_ready_.notify_all();
+        for (auto &w : workers_)
+            w.join();
+    }
+
+    const char *name() const override { return "threads"; }
+
+    size_t submit(IoOp *const *ops, size_t count) override
+    {
+        {
+            lock_guard<mutex> lock(mutex_);
+            pending_.insert(pending_.end(), ops, ops + count);
+        }
+        work_ready_.notify_all();
+        return count;
+    }
+
+    void reap(vector<IoOp *> &done, bool wait) override
+    {
+        unique_lock<mutex> lock(mutex_);
+        if (wait)
+            done_ready_.wait(lock, [this]
+                             { return !finished_.empty(); });
+        done.insert(done.end(), finished_.begin(), finished_.end());
+        finished_.clear();
+    }
+
+private:
+    // 每次取走一小批操作，做完后一起交回，减少加锁和唤醒的次数；
+    // 排队的操作少时每个线程只取一个，保持并发
+    void work()
+    {
+        vector<IoOp *> batch;
+        unique_lock<mutex> lock(mutex_);
+        for (;;)
+        {
+            work_ready_.wait(lock, [this]
+                             { return stopping_ || !pending_.empty(); });
+            if (stopping_)
+                return;
+            size_t n = min(worker_batch, max<size_t>(1, pending_.size() / workers_.size()));
+            batch.assign(pending_.begin(), pending_.begin() + n);
+            pending_.erase(pending_.begin(), pending_.begin() + n);
+            lock.unlock();
+            for (IoOp *op : batch)
+                execute(*op);
+            lock.lock();
+            // 事件循环只在 finished_ 为空时等待
+            bool was_empty = finished_.empty();
+            finished_.insert(finished_.end(), batch.begin(), batch.end());
+            if (was_empty)
+                done_ready_.notify_one();
+        }
+    }
+
+    vector<thread> workers_;
+    mutex mutex_;
+    condition_variable work_ready_, done_ready_;
+    deque<IoOp *> pending_;
+    vector<IoOp *> finished_;
+    bool stopping_ = false;
+};
+
+#ifdef DIGITS_IO_URING
+static int uringSetup(unsigned entries, io_uring_params *params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int uringRegister(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// io_uring 后端，直接用系统调用而不依赖 liburing。提交队列只由事件循环线程写入；
+// 每轮新填的 SQE 与等待完成合并为一次 io_uring_enter
+class UringEngine : public IoLoop::Engine
+{
+public:
+    ~UringEngine() override
+    {
+        if (sqes_)
+            munmap(sqes_, sqes_len_);
+        if (cq_ring_ && cq_ring_ != sq_ring_)
+            munmap(cq_ring_, cq_len_);
+        if (sq_ring_)
+            munmap(sq_ring_, sq_len_);
+        if (ring_fd_ >= 0)
+            ::close(ring_fd_);
+    }
+
+    // 内核不支持 io_uring（或被禁用）、缺少所需操作时返回 false
+    bool init(unsigned depth)
+    {
+        io_uring_params p = {};
+        ring_fd_ = uringSetup(depth, &p);
+        if (ring_fd_ < 0)
+            return false;
+        sq_entries_ = p.sq_entries;
+        cq_entries_ = p.cq_entries;
+
+        sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap)
+            sq_len_ = cq_len_ = max(sq_len_, cq_len_);
+        void *sq = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (sq == MAP_FAILED)
+            return false;
+        sq_ring_ = sq;
+        void *cq = single_mmap ? sq : mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED)
+            return false;
+        cq_ring_ = cq;
+        sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return false;
+        sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+        char *sq_base = static_cast<char *>(sq_ring_), *cq_base = static_cast<char *>(cq_ring_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq_base + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq_base + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq_base + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq_base + p.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned *>(cq_base + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq_base + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq_base + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq_base + p.cq_off.cqes);
+        return supported();
+    }
+
+    const char *name() const override { return "io_uring"; }
+
+    size_t submit(IoOp *const *ops, size_t count) override
+    {
+        // 在途的操作不超过完成队列的容量，避免溢出
+        unsigned head = atomic_ref<unsigned>(*sq_head_).load(memory_order_acquire);
+        unsigned tail = *sq_tail_;
+        size_t room = min<size_t>(sq_entries_ - (tail - head), cq_entries_ - inflight_);
+        size_t n = min(count, room);
+        for (size_t i = 0; i < n; i++, tail++)
+        {
+            const IoOp &op = *ops[i];
+            unsigned index = tail & sq_mask_;
+            io_uring_sqe &sqe = sqes_[index];
+            memset(&sqe, 0, sizeof(sqe));
+            switch (op.kind)
+            {
+            case IoOp::Kind::Open:
+                sqe.opcode = IORING_OP_OPENAT;
+                sqe.fd = AT_FDCWD;
+                sqe.addr = reinterpret_cast<uint64_t>(op.path);
+                sqe.open_flags = O_RDONLY | O_CLOEXEC;
+                break;
+            case IoOp::Kind::Read:
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = op.fd;
+                sqe.addr = reinterpret_cast<uint64_t>(op.buf);
+                sqe.len = op.len;
+                sqe.off = op.offset;
+                break;
+            case IoOp::Kind::Close:
+                sqe.opcode = IORING_OP_CLOSE;
+                sqe.fd = op.fd;
+                break;
+            }
+            sqe.user_data = reinterpret_cast<uint64_t>(ops[i]);
+            sq_array_[index] = index;
+        }
+        atomic_ref<unsigned>(*sq_tail_).store(tail, memory_order_release);
+        unsubmitted_ += n;
+        inflight_ += n;
+        return n;
+    }
+
+    void reap(vector<IoOp *> &done, bool wait) override
+    {
+        for (;;)
+        {
+            unsigned head = *cq_head_;
+            unsigned tail = atomic_ref<unsigned>(*cq_tail_).load(memory_order_acquire);
+            bool block = wait && head == tail;
+            if (unsubmitted_ > 0 || block)
+            {
+                int r = uringEnter(ring_fd_, unsubmitted_, block ? 1 : 0, block ? IORING_ENTER_GETEVENTS : 0);
+                if (r >= 0)
+                    unsubmitted_ -= r;
+                else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                {
+                    cerr << "Error: io_uring_enter failed: " << strerror(errno) << endl;
+                    abort();
+                }
+                tail = atomic_ref<unsigned>(*cq_tail_).load(memory_order_acquire);
+            }
+            for (; head != tail; head++)
+            {
+                const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+                IoOp *op = reinterpret_cast<IoOp *>(cqe.user_data);
+                op->result = cqe.res;
+                done.push_back(op);
+                inflight_--;
+            }
+            atomic_ref<unsigned>(*cq_head_).store(head, memory_order_release);
+            if (!wait || !done.empty())
+                return;
+        }
+    }
+
+private:
+    bool supported()
+    {
+        const unsigned probe_ops = 256;
+        vector<uint8_t> buffer(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op), 0);
+        auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+        if (uringRegister(ring_fd_, IORING_REGISTER_PROBE, probe, probe_ops) < 0)
+            return false;
+        for (int op : {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE})
+        {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                return false;
+        }
+        return true;
+    }
+
+    int ring_fd_ = -1;
+    void *sq_ring_ = nullptr, *cq_ring_ = nullptr;
+    size_t sq_len_ = 0, cq_len_ = 0, sqes_len_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+    unsigned *sq_head_, *sq_tail_, *sq_array_, *cq_head_, *cq_tail_;
+    unsigned sq_mask_ = 0, cq_mask_ = 0, sq_entries_ = 0, cq_entries_ = 0;
+    unsigned unsubmitted_ = 0; // 已写入提交队列、尚未交给内核的 SQE
+    unsigned inflight_ = 0;    // 已写入提交队列、尚未收割完成的操作
+};
+#endif
+
+IoLoop::IoLoop(IoBackend backend, unsigned depth, unsigned threads)
+{
+    depth = max(1u, depth);
+#ifdef DIGITS_IO_URING
+    if (backend != IoBackend::Threads)
+    {
+        unique_ptr<UringEngine> uring(new UringEngine());
+        if (uring->init(depth))
+            engine_ = move(uring);
+        else if (backend == IoBackend::IoUring)
+            cerr << "Warning: io_uring is not available, falling back to thread pool" << endl;
+    }
+#else
+    if (backend == IoBackend::IoUring)
+        cerr << "Warning: built without io_uring support, falling back to thread pool" << endl;
+#endif
+    if (!engine_)
+    {
+        // 阻塞读取时线程多半在等磁盘，线程数取 CPU 数的两倍
+        if (threads == 0)
+            threads = max(4u, 2 * thread::hardware_concurrency());
+        engine_.reset(new ThreadEngine(min(threads, depth)));
+    }
+}
+
+IoLoop::~IoLoop() = default;
+
+const char *IoLoop::backendName() const
+{
+    return engine_->name();
+}
+
+void IoOp::await_suspend(coroutine_handle<> handle)
+{
+    waiter = handle;
+    loop_.queued_.push_back(this);
+}
+
+IoOp IoLoop::open(const char *path)
+{
+    IoOp op(*this, IoOp::Kind::Open);
+    op.path = path;
+    return op;
+}
+
+IoOp IoLoop::read(int fd, void *buf, uint32_t len, uint64_t offset)
+{
+    IoOp op(*this, IoOp::Kind::Read);
+    op.fd = fd;
+    op.buf = buf;
+    op.len = len;
+    op.offset = offset;
+    return op;
+}
+
+IoOp IoLoop::close(int fd)
+{
+    IoOp op(*this, IoOp::Kind::Close);
+    op.fd = fd;
+    return op;
+}
+
+void IoLoop::run()
+{
+    size_t inflight = 0;
+    vector<IoOp *> done;
+    while (!queued_.empty() || inflight > 0)
+    {
+        if (!queued_.empty())
+        {
+            size_t n = engine_->submit(queued_.data(), queued_.size());
+            queued_.erase(queued_.begin(), queued_.begin() + n);
+            inflight += n;
+        }
+        done.clear();
+        engine_->reap(done, true);
+        inflight -= done.size();
+        // 恢复的协程会把下一次操作放进 queued_，下一轮一起提交
+        for (IoOp *op : done)
+            op->waiter.resume();
+    }
+}
+
+// loadBMPFiles 的共享状态，只在事件循环线程上访问
+struct BMPLoad
+{
+    IoLoop &loop;
+    const vector<string> &paths;
+    const function<void(size_t, const vector<uint8_t> &)> &consume;
+    size_t window;
+    size_t next = 0;      // 下一个要读的文件
+    size_t delivered = 0; // 之前的文件都已交付或跳过
+    size_t decoded = 0;
+    vector<vector<uint8_t>> slots;     // 下标模 window：已解码、尚未交付的图片
+    vector<int8_t> state;              // 0 未完成，1 成功，-1 失败
+    vector<coroutine_handle<>> parked; // 窗口已满，等待交付推进的协程
+};
+
+struct ParkAwaitable
+{
+    BMPLoad &load;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(coroutine_handle<> handle) { load.parked.push_back(handle); }
+    void await_resume() const noexcept {}
+};
+
+// 记录第 index 个文件的结果，并按顺序交付从 delivered 开始连续完成的部分
+static void finishFile(BMPLoad &load, size_t index, bool ok)
+{
+    load.state[index % load.window] = ok ? 1 : -1;
+    while (load.delivered < load.next && load.state[load.delivered % load.window] != 0)
+    {
+        size_t slot = load.delivered % load.window;
+        if (load.state[slot] > 0)
+        {
+            load.consume(load.delivered, load.slots[slot]);
+            load.decoded++;
+        }
+        load.state[slot] = 0;
+        load.delivered++;
+    }
+    if (!load.parked.empty())
+    {
+        vector<coroutine_handle<>> wake;
+        wake.swap(load.parked);
+        for (auto handle : wake)
+            handle.resume();
+    }
+}
+
+// 一个读取协程：反复领取下一个文件，打开、读取、关闭、解码。
+// 同时运行 depth 个，事件循环每轮把它们排队的操作一起提交
+static IoTask loadWorker(BMPLoad &load)
+{
+    vector<uint8_t> file(bmp_buffer);
+    while (load.next < load.paths.size())
+    {
+        if (load.next >= load.delivered + load.window)
+        {
+            co_await ParkAwaitable{load};
+            continue;
+        }
+        size_t index = load.next++;
+        const string &path = load.paths[index];
+        int fd = co_await load.loop.open(path.c_str());
+        if (fd < 0)
+        {
+            cerr << "Error: Could not open file " << path << endl;
+            decodeFailures().add();
+            finishFile(load, index, false);
+            continue;
+        }
+
+        // 普通文件只在文件尾读不满；读满说明文件比缓冲区大，加倍后接着读，
+        // 缓冲区到 max_bmp_file 仍读满则文件过大，不再读下去
+        size_t got = 0;
+        int n;
+        bool too_large = false;
+        while ((n = co_await load.loop.read(fd, file.data() + got, file.size() - got, got)) > 0)
+        {
+            got += n;
+            if (got < file.size())
+                break;
+            if (file.size() >= max_bmp_file)
+            {
+                too_large = true;
+                break;
+            }
+            file.resize(min(file.size() * 2, max_bmp_file));
+        }
+        co_await load.loop.close(fd);
+
+        long size = n < 0 || too_large ? 0 : parseBMP(file.data(), got, load.slots[index % load.window]);
+        if (size == 0)
+            decodeFailures().add(); // 读取出错、文件不完整或过大；格式错误已由 parseBMP 计数
+        if (too_large)
+            cerr << "Error: BMP file larger than " << max_bmp_file << " bytes: " << path << endl;
+        else if (size <= 0)
+            cerr << "Error: Not a valid BMP file: " << path << endl;
+        finishFile(load, index, size > 0);
+    }
+}
+
+size_t loadBMPFiles(const vector<string> &paths,
+                    const function<void(size_t index, const vector<uint8_t> &pixels)> &consume,
+                    IoBackend backend, unsigned depth)
+{
+    depth = max(1u, depth);
+    IoLoop loop(backend, depth);
+    BMPLoad load{loop, paths, consume, depth * window_factor};
+    load.slots.resize(load.window);
+    load.state.assign(load.window, 0);
+    for (size_t w = 0; w < depth && w < paths.size(); w++)
+        loadWorker(load);
+    loop.run();
+    return load.decoded;
+}
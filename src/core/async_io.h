@@ -0,0 +1,102 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 异步读取大量小文件。单线程事件循环驱动 C++20 协程：协程 co_await 一次 I/O 操作后挂起，
+// 事件循环把挂起期间排队的所有操作一次提交，操作完成后在同一线程上恢复对应的协程，
+// 所以协程之间不需要加锁。
+//
+// 后端：io_uring（编译时开启 DIGITS_IO_URING 且内核支持 openat/read/close 时）或线程池
+// （阻塞系统调用在工作线程中执行）。Auto 优先 io_uring，不可用时退回线程池
+
+enum class IoBackend
+{
+    Auto,
+    IoUring,
+    Threads,
+};
+
+bool parseIoBackend(const std::string &text, IoBackend &backend);
+
+class IoLoop;
+
+// 一次 I/O 操作，作为 co_await 的对象；结果为系统调用的返回值，失败时为 -errno
+class IoOp
+{
+public:
+    enum class Kind
+    {
+        Open, // O_RDONLY | O_CLOEXEC，结果为文件描述符
+        Read, // pread，结果为读到的字节数
+        Close,
+    };
+
+    IoOp(IoLoop &loop, Kind kind) : kind(kind), loop_(loop) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    int await_resume() const noexcept { return result; }
+
+    Kind kind;
+    const char *path = nullptr;
+    int fd = -1;
+    void *buf = nullptr;
+    uint32_t len = 0;
+    uint64_t offset = 0;
+    int result = 0;
+    std::coroutine_handle<> waiter;
+
+private:
+    IoLoop &loop_;
+};
+
+// 立即开始执行的协程，执行完自动销毁；挂起期间由 IoLoop::run 负责恢复
+struct IoTask
+{
+    struct promise_type
+    {
+        IoTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+class IoLoop
+{
+public:
+    // depth：同时在途的操作上限（io_uring 的队列深度）；threads：线程池大小，0 表示按 CPU 数
+    explicit IoLoop(IoBackend backend = IoBackend::Auto, unsigned depth = 256, unsigned threads = 0);
+    ~IoLoop();
+    IoLoop(const IoLoop &) = delete;
+    IoLoop &operator=(const IoLoop &) = delete;
+
+    const char *backendName() const;
+
+    IoOp open(const char *path);
+    IoOp read(int fd, void *buf, uint32_t len, uint64_t offset);
+    IoOp close(int fd);
+
+    // 提交排队的操作、收割完成的操作并恢复协程，直到没有排队或在途的操作
+    void run();
+
+    struct Engine;
+
+private:
+    friend class IoOp;
+    std::unique_ptr<Engine> engine_;
+    std::vector<IoOp *> queued_;
+};
+
+// 用 depth 个协程并发读取并解码 28x28 的 8 位 BMP（见 parseBMP），按 paths 的顺序在调用线程上
+// 交给 consume。读不到、格式不对或超过 64 KB 的文件报错并跳过。返回成功解码的张数
+size_t loadBMPFiles(const std::vector<std::string> &paths,
+                    const std::function<void(size_t index, const std::vector<uint8_t> &pixels)> &consume,
+                    IoBackend backend = IoBackend::Auto, unsigned depth = 256);
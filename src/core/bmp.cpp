@@ -0,0 +1,168 @@
+#include "core/bmp.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "core/metrics.h"
+using namespace std;
+
+static Counter &imagesDecoded()
+{
+    static Counter &c = metrics().counter("digits_images_decoded_total", "BMP images decoded");
+    return c;
+}
+
+static Counter &decodeFailures()
+{
+    static Counter &c = metrics().counter("digits_decode_failures_total", "BMP files that could not be opened or parsed");
+    return c;
+}
+
+bool readBMP(const string &filename, vector<uint8_t> &pixelData)
+{
+    Counter &decoded = imagesDecoded();
+    Counter &failures = decodeFailures();
+    BMPHeader bmpHeader;
+    BMPInfoHeader bmpInfoHeader;
+
+    ifstream inputFile(filename, ios::binary);
+    if (!inputFile)
+    {
+        cerr << "Error: Could not open file " << filename << endl;
+        failures.add();
+        return false;
+    }
+
+    // 读取文件头
+    inputFile.read(reinterpret_cast<char *>(&bmpHeader), sizeof(bmpHeader));
+    if (bmpHeader.bfType[0] != 'B' || bmpHeader.bfType[1] != 'M')
+    {
+        cerr << "Error: Not a valid BMP file." << endl;
+        failures.add();
+        return false;
+    }
+
+    // 读取信息头
+    inputFile.read(reinterpret_cast<char *>(&bmpInfoHeader), sizeof(bmpInfoHeader));
+
+    // 读取像素数据
+    inputFile.seekg(bmpHeader.bfOffBits, ios::beg);
+    int rowSize = ((bmpInfoHeader.biWidth * bmpInfoHeader.biBitCount + 31) / 32) * 4; // 每行字节数
+    int imageSize = rowSize * abs(bmpInfoHeader.biHeight);
+    pixelData.resize(imageSize);
+    inputFile.read(reinterpret_cast<char *>(pixelData.data()), imageSize);
+
+    inputFile.close();
+    decoded.add();
+    return true;
+}
+
+long parseBMP(const uint8_t *data, size_t available, vector<uint8_t> &pixels)
+{
+    if (available < sizeof(BMPHeader) + sizeof(BMPInfoHeader))
+        return 0;
+    BMPHeader header;
+    BMPInfoHeader info;
+    memcpy(&header, data, sizeof(header));
+    memcpy(&info, data + sizeof(header), sizeof(info));
+    // 像素区必须落在头部之后、文件之内；用减法比较，构造的偏移量不会让 uint32 回绕
+    const uint32_t header_size = sizeof(BMPHeader) + sizeof(BMPInfoHeader);
+    if (header.bfType[0] != 'B' || header.bfType[1] != 'M' || info.biWidth != 28 ||
+        abs(info.biHeight) != 28 || info.biBitCount != 8 || header.bfOffBits < header_size ||
+        header.bfOffBits > header.bfSize || header.bfSize - header.bfOffBits < 28 * 28)
+    {
+        decodeFailures().add();
+        return -1;
+    }
+    if (available < header.bfSize)
+        return 0;
+    pixels.assign(data + header.bfOffBits, data + header.bfOffBits + 28 * 28);
+    imagesDecoded().add();
+    return header.bfSize;
+}
+
+static inline uint8_t luma(uint8_t b, uint8_t g, uint8_t r)
+{
+    return (uint8_t)((299 * r + 587 * g + 114 * b + 500) / 1000);
+}
+
+bool readGrayBMP(const string &filename, GrayImage &image)
+{
+    Counter &decoded = imagesDecoded();
+    Counter &failures = decodeFailures();
+
+    // 整个文件一次读入，大图也只有一次 read
+    ifstream inputFile(filename, ios::binary | ios::ate);
+    if (!inputFile)
+    {
+        cerr << "Error: Could not open file " << filename << endl;
+        failures.add();
+        return false;
+    }
+    vector<uint8_t> data((size_t)inputFile.tellg());
+    inputFile.seekg(0, ios::beg);
+    inputFile.read(reinterpret_cast<char *>(data.data()), data.size());
+
+    BMPHeader header;
+    BMPInfoHeader info;
+    if (!inputFile || data.size() < sizeof(header) + sizeof(info))
+    {
+        cerr << "Error: Not a valid BMP file: " << filename << endl;
+        failures.add();
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    memcpy(&info, data.data() + sizeof(header), sizeof(info));
+    int bits = info.biBitCount;
+    int width = info.biWidth, height = info.biHeight == INT_MIN ? 0 : abs(info.biHeight);
+    size_t row_size = ((size_t)width * bits + 31) / 32 * 4;
+    // 用除法检查像素区是否在文件内，宽高很大时 row_size * height 也不会溢出
+    if (header.bfType[0] != 'B' || header.bfType[1] != 'M' || info.biCompression != 0 ||
+        (bits != 8 && bits != 24 && bits != 32) || width <= 0 || height <= 0 ||
+        header.bfOffBits > data.size() || (data.size() - header.bfOffBits) / row_size < (size_t)height)
+    {
+        cerr << "Error: Unsupported BMP file (need uncompressed 8/24/32-bit): " << filename << endl;
+        failures.add();
+        return false;
+    }
+
+    // 8 位图的调色板紧跟在信息头之后
+    uint8_t palette[256];
+    for (int i = 0; i < 256; i++)
+        palette[i] = (uint8_t)i;
+    if (bits == 8)
+    {
+        size_t colors = info.biClrUsed ? min<size_t>(info.biClrUsed, 256) : 256;
+        size_t table = sizeof(header) + info.biSize;
+        for (size_t i = 0; i < colors && table + 4 * i + 3 <= header.bfOffBits; i++)
+            palette[i] = luma(data[table + 4 * i], data[table + 4 * i + 1], data[table + 4 * i + 2]);
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height);
+    for (int y = 0; y < height; y++)
+    {
+        // 高度为负表示自上而下存放，翻转成自下而上的顺序
+        int src_row = info.biHeight < 0 ? height - 1 - y : y;
+        const uint8_t *src = data.data() + header.bfOffBits + row_size * src_row;
+        uint8_t *dst = image.pixels.data() + (size_t)y * width;
+        if (bits == 8)
+        {
+            for (int x = 0; x < width; x++)
+                dst[x] = palette[src[x]];
+        }
+        else
+        {
+            int step = bits / 8;
+            for (int x = 0; x < width; x++)
+                dst[x] = luma(src[x * step], src[x * step + 1], src[x * step + 2]);
+        }
+    }
+    decoded.add();
+    return true;
+}
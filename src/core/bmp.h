@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// BMP文件头结构
+#pragma pack(push, 1)
+struct BMPHeader
+{
+    char bfType[2];  // 文件类型，必须是"BM"
+    uint32_t bfSize; // 文件大小
+    uint16_t bfReserved1;
+    uint16_t bfReserved2;
+    uint32_t bfOffBits; // 数据偏移量
+};
+
+// BMP信息头结构
+struct BMPInfoHeader
+{
+    uint32_t biSize;         // 信息头大小
+    int32_t biWidth;         // 图像宽度
+    int32_t biHeight;        // 图像高度
+    uint16_t biPlanes;       // 色彩平面数，必须是1
+    uint16_t biBitCount;     // 位深度
+    uint32_t biCompression;  // 压缩类型，0表示不压缩
+    uint32_t biSizeImage;    // 图像数据大小
+    int32_t biXPelsPerMeter; // 水平分辨率
+    int32_t biYPelsPerMeter; // 垂直分辨率
+    uint32_t biClrUsed;      // 使用的颜色数，0表示使用所有
+    uint32_t biClrImportant; // 重要颜色数，0表示全部重要
+};
+#pragma pack(pop)
+
+// 读取BMP文件：pixelData 为文件中按行存放的原始像素（含行尾填充，行顺序与文件一致）
+bool readBMP(const std::string &filename, std::vector<uint8_t> &pixelData);
+
+// 从内存中的完整 BMP 文件取出 28x28 的 8 位像素（不含行尾填充）；
+// 返回文件总长度，数据不足返回 0，格式错误返回 -1
+long parseBMP(const uint8_t *data, size_t available, std::vector<uint8_t> &pixels);
+
+// 任意尺寸的灰度图，每行 width 字节、无填充。行顺序统一为 BMP 自下而上存放时的顺序，
+// 与 readBMP 读到的 28x28 训练样本一致，从中裁出的数字可直接送入网络
+struct GrayImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    uint8_t at(int x, int y) const { return pixels[(size_t)y * width + x]; }
+};
+
+// 读取未压缩的 8 位（按调色板换算灰度）、24 位或 32 位 BMP 并转为灰度
+bool readGrayBMP(const std::string &filename, GrayImage &image);
@@ -0,0 +1,107 @@
+#include "core/dataset.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "core/async_io.h"
+#include "core/network.h"
+#include "core/preprocess.h"
+using namespace std;
+
+void loadDataset(const string &root, int per_class, vector<Sample> &dataset)
+{
+    vector<string> paths;
+    vector<int> labels;
+    paths.reserve(output_size * per_class);
+    for (int label = 0; label < output_size; ++label)
+    {
+        for (int idx = 1; idx <= per_class; ++idx)
+        {
+            paths.push_back(root + "/" + to_string(label) + "/" +
+                            to_string(label) + "_" + to_string(idx) + ".bmp");
+            labels.push_back(label);
+        }
+    }
+
+    // 异步批量读取，按路径顺序交付；读不到的文件跳过
+    dataset.reserve(dataset.size() + paths.size());
+    loadBMPFiles(paths, [&](size_t index, const vector<uint8_t> &raw)
+                 {
+                     Sample s;
+                     s.label = labels[index];
+                     s.source = paths[index];
+                     s.input.resize(input_size);
+                     for (int i = 0; i < input_size; ++i)
+                         s.input[i] = raw[i] / 255.0f;
+                     dataset.push_back(move(s)); });
+}
+
+bool loadPacked(const string &filename, vector<Sample> &dataset)
+{
+    ifstream inFile(filename, ios::binary);
+    if (!inFile)
+    {
+        cerr << "Error: Could not open file " << filename << " for reading." << endl;
+        return false;
+    }
+
+    vector<uint8_t> record(1 + input_size);
+    size_t index = 0;
+    while (inFile.read(reinterpret_cast<char *>(record.data()), record.size()))
+    {
+        if (record[0] >= output_size)
+        {
+            cerr << "Error: Bad label " << (int)record[0] << " in record " << index << endl;
+            return false;
+        }
+        Sample s;
+        s.label = record[0];
+        s.source = filename + "#" + to_string(index++);
+        s.input.resize(input_size);
+        for (int i = 0; i < input_size; ++i)
+            s.input[i] = record[1 + i] / 255.0f;
+        dataset.push_back(move(s));
+    }
+    // 读到文件尾时不足一条记录：文件被截断
+    if (inFile.gcount() != 0)
+    {
+        cerr << "Error: " << filename << " is truncated: " << inFile.gcount() << " trailing bytes after record "
+             << index << endl;
+        return false;
+    }
+    return true;
+}
+
+bool savePacked(const string &filename, const vector<Sample> &dataset)
+{
+    ofstream outFile(filename, ios::binary);
+    if (!outFile)
+    {
+        cerr << "Error: Could not open file " << filename << " for writing." << endl;
+        return false;
+    }
+
+    vector<uint8_t> record(1 + input_size);
+    for (const auto &s : dataset)
+    {
+        record[0] = (uint8_t)s.label;
+        for (int i = 0; i < input_size; ++i)
+            record[1 + i] = (uint8_t)lround(s.input[i] * 255.0f);
+        outFile.write(reinterpret_cast<const char *>(record.data()), record.size());
+    }
+    // 磁盘满或 I/O 错误时不能把截断的文件当作成功
+    outFile.close();
+    if (!outFile)
+    {
+        cerr << "Error: Failed to write packed dataset " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+void preprocessDataset(vector<Sample> &dataset)
+{
+    for (auto &s : dataset)
+        preprocessDigit(s.input.data(), s.input.data());
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// 一条带标签的样本，像素已归一化到 0-1
+struct Sample
+{
+    std::vector<float> input;
+    int label;
+    std::string source; // 文件路径或打包文件中的记录号
+};
+
+// 从 train_bmp 目录树读取：<root>/<label>/<label>_<idx>.bmp，idx 从 1 到 per_class，
+// 读不到的文件跳过。文件经 loadBMPFiles 异步批量读取，样本顺序与路径顺序一致
+void loadDataset(const std::string &root, int per_class, std::vector<Sample> &dataset);
+
+// 打包数据集格式：每条记录 1 字节标签 + 784 字节像素（与 BMP 中的行顺序一致）
+// 标签越界或文件末尾不足一条记录（被截断）时报错并返回 false
+bool loadPacked(const std::string &filename, std::vector<Sample> &dataset);
+bool savePacked(const std::string &filename, const std::vector<Sample> &dataset);
+
+// 对数据集中每张图片做输入预处理（见 core/preprocess.h）
+void preprocessDataset(std::vector<Sample> &dataset);
@@ -0,0 +1,42 @@
+#include "core/half.h"
+
+void convertToHalf(const float *src, uint16_t *dst, size_t n, HalfFormat format)
+{
+    size_t i = 0;
+    if (format == HalfFormat::BF16)
+    {
+        for (; i < n; ++i)
+            dst[i] = floatToBF16(src[i]);
+        return;
+    }
+#ifdef __F16C__
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), h);
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = floatToFP16(src[i]);
+}
+
+void convertToFloat(const uint16_t *src, float *dst, size_t n, HalfFormat format)
+{
+    size_t i = 0;
+    if (format == HalfFormat::BF16)
+    {
+        for (; i < n; ++i)
+            dst[i] = bf16ToFloat(src[i]);
+        return;
+    }
+#ifdef __F16C__
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = fp16ToFloat(src[i]);
+}
+
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+
+// 半精度存储格式：权重和激活以 16 位保存，运算时展开为 fp32 累加
+enum class HalfFormat : uint32_t
+{
+    BF16 = 1,
+    FP16 = 2,
+};
+
+inline uint16_t floatToBF16(float f)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000)
+        return (bits >> 16) | 0x40; // 保持 NaN
+    bits += 0x7fff + ((bits >> 16) & 1); // 就近舍入到偶数
+    return bits >> 16;
+}
+
+inline float bf16ToFloat(uint16_t h)
+{
+    uint32_t bits = (uint32_t)h << 16;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline uint16_t floatToFP16(float f)
+{
+#ifdef __F16C__
+    return _cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t mant = bits & 0x7fffff;
+    int32_t exp = (bits >> 23) & 0xff;
+    if (exp == 0xff)
+        return sign | 0x7c00 | (mant ? 0x200 : 0);
+    int32_t e = exp - 127 + 15;
+    if (e >= 0x1f)
+        return sign | 0x7c00;
+    if (e <= 0)
+    {
+        // 非规格化数
+        if (e < -10)
+            return sign;
+        mant |= 0x800000;
+        int shift = 14 - e;
+        uint32_t h = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1)))
+            h++;
+        return sign | h;
+    }
+    uint32_t h = sign | (e << 10) | (mant >> 13);
+    uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+        h++; // 进位可能溢出到指数，结果仍然正确
+    return h;
+#endif
+}
+
+inline float fp16ToFloat(uint16_t h)
+{
+#ifdef __F16C__
+    return _cvtsh_ss(h);
+#else
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f)
+        bits = sign | 0x7f800000 | (mant << 13);
+    else if (exp == 0)
+    {
+        float f = std::ldexp((float)mant, -24);
+        return sign ? -f : f;
+    }
+    else
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+#endif
+}
+
+template <HalfFormat F>
+inline float halfToFloat(uint16_t h)
+{
+    return F == HalfFormat::BF16 ? bf16ToFloat(h) : fp16ToFloat(h);
+}
+
+// 批量转换；bf16 的移位循环可被编译器自动向量化，fp16 在支持 F16C 时每次转换 8 个
+void convertToHalf(const float *src, uint16_t *dst, size_t n, HalfFormat format);
+void convertToFloat(const uint16_t *src, float *dst, size_t n, HalfFormat format);
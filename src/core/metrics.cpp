@@ -0,0 +1,308 @@
+#include "core/metrics.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+
+int metricShard()
+{
+    static atomic<int> next{0};
+    thread_local int shard = next.fetch_add(1, memory_order_relaxed) % metric_shards;
+    return shard;
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const auto &cell : cells_)
+        total += cell.value.load(memory_order_relaxed);
+    return total;
+}
+
+void Gauge::add(double v)
+{
+    double old = value_.load(memory_order_relaxed);
+    while (!value_.compare_exchange_weak(old, old + v, memory_order_relaxed))
+    {
+    }
+}
+
+void Histogram::observe(double seconds)
+{
+    // 第一个上界不小于 seconds 的桶：1 微秒乘 2^b，直接由指数算出
+    int b = 0;
+    if (seconds > bucketBound(0))
+    {
+        int exponent;
+        double mantissa = frexp(seconds * 1e6, &exponent); // seconds * 1e6 = mantissa * 2^exponent
+        b = mantissa == 0.5 ? exponent - 1 : exponent;
+        if (b > metric_buckets)
+            b = metric_buckets;
+    }
+    Shard &shard = shards_[metricShard()];
+    shard.counts[b].fetch_add(1, memory_order_relaxed);
+    shard.sum_ns.fetch_add(seconds > 0 ? (uint64_t)(seconds * 1e9) : 0, memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot s;
+    uint64_t sum_ns = 0;
+    for (const auto &shard : shards_)
+    {
+        for (int b = 0; b <= metric_buckets; b++)
+            s.counts[b] += shard.counts[b].load(memory_order_relaxed);
+        sum_ns += shard.sum_ns.load(memory_order_relaxed);
+    }
+    for (int b = 0; b <= metric_buckets; b++)
+        s.count += s.counts[b];
+    s.sum = sum_ns * 1e-9;
+    return s;
+}
+
+void *MetricsRegistry::find(const string &name, Kind kind) const
+{
+    for (const auto &e : entries_)
+    {
+        if (e.name == name && e.kind == kind)
+            return e.metric;
+    }
+    return nullptr;
+}
+
+Counter &MetricsRegistry::counter(const string &name, const string &help)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (void *m = find(name, Kind::Counter))
+        return *static_cast<Counter *>(m);
+    counters_.emplace_back();
+    entries_.push_back({name, help, Kind::Counter, &counters_.back(), nullptr});
+    return counters_.back();
+}
+
+Gauge &MetricsRegistry::gauge(const string &name, const string &help)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (void *m = find(name, Kind::Gauge))
+        return *static_cast<Gauge *>(m);
+    gauges_.emplace_back();
+    entries_.push_back({name, help, Kind::Gauge, &gauges_.back(), nullptr});
+    return gauges_.back();
+}
+
+Histogram &MetricsRegistry::histogram(const string &name, const string &help)
+{
+    lock_guard<mutex> lock(mutex_);
+    if (void *m = find(name, Kind::Histogram))
+        return *static_cast<Histogram *>(m);
+    histograms_.emplace_back();
+    entries_.push_back({name, help, Kind::Histogram, &histograms_.back(), nullptr});
+    return histograms_.back();
+}
+
+void MetricsRegistry::gaugeFunction(const string &name, const string &help, function<double()> fn)
+{
+    lock_guard<mutex> lock(mutex_);
+    for (auto &e : entries_)
+    {
+        if (e.name == name && e.kind == Kind::Function)
+        {
+            e.fn = move(fn);
+            return;
+        }
+    }
+    entries_.push_back({name, help, Kind::Function, nullptr, move(fn)});
+}
+
+// JSON 与 Prometheus 都不接受 nan / inf 字面量
+static string formatNumber(double v)
+{
+    if (std::isnan(v))
+        return "0";
+    if (std::isinf(v))
+        return v > 0 ? "1e308" : "-1e308";
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.9g", v);
+    return buf;
+}
+
+string MetricsRegistry::render(MetricsFormat format) const
+{
+    lock_guard<mutex> lock(mutex_);
+    ostringstream out;
+    bool json = format == MetricsFormat::Json;
+    if (json)
+    {
+        auto now = chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count();
+        char timestamp[32];
+        snprintf(timestamp, sizeof(timestamp), "%.3f", now);
+        out << "{\"timestamp\": " << timestamp << ", \"metrics\": {";
+    }
+    bool first = true;
+    for (const auto &e : entries_)
+    {
+        const char *type = e.kind == Kind::Counter ? "counter" : e.kind == Kind::Histogram ? "histogram"
+                                                                                            : "gauge";
+        if (json)
+            out << (first ? "\n" : ",\n") << "  \"" << e.name << "\": ";
+        else
+            out << "# HELP " << e.name << " " << e.help << "\n# TYPE " << e.name << " " << type << "\n";
+        first = false;
+
+        if (e.kind == Kind::Histogram)
+        {
+            Histogram::Snapshot s = static_cast<const Histogram *>(e.metric)->snapshot();
+            uint64_t cumulative = 0;
+            if (json)
+                out << "{\"count\": " << s.count << ", \"sum\": " << formatNumber(s.sum) << ", \"buckets\": [";
+            for (int b = 0; b <= metric_buckets; b++)
+            {
+                cumulative += s.counts[b];
+                string le = b < metric_buckets ? formatNumber(Histogram::bucketBound(b)) : "+Inf";
+                if (json)
+                    out << (b ? ", " : "") << "[\"" << le << "\", " << cumulative << "]";
+                else
+                    out << e.name << "_bucket{le=\"" << le << "\"} " << cumulative << "\n";
+            }
+            if (json)
+                out << "]}";
+            else
+                out << e.name << "_sum " << formatNumber(s.sum) << "\n"
+                    << e.name << "_count " << s.count << "\n";
+            continue;
+        }
+
+        if (e.kind == Kind::Counter)
+        {
+            uint64_t count = static_cast<const Counter *>(e.metric)->value();
+            if (json)
+                out << count;
+            else
+                out << e.name << " " << count << "\n";
+            continue;
+        }
+
+        double v = 0.0;
+        if (e.kind == Kind::Gauge)
+            v = static_cast<const Gauge *>(e.metric)->value();
+        else
+            v = e.fn();
+        if (json)
+            out << formatNumber(v);
+        else
+            out << e.name << " " << formatNumber(v) << "\n";
+    }
+    if (json)
+        out << "\n}}\n";
+    return out.str();
+}
+
+MetricsRegistry &metrics()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+bool parseMetricsFormat(const string &text, MetricsFormat &format)
+{
+    if (text == "prometheus")
+        format = MetricsFormat::Prometheus;
+    else if (text == "json")
+        format = MetricsFormat::Json;
+    else
+        return false;
+    return true;
+}
+
+MetricsReporter::MetricsReporter(string target, MetricsFormat format, double interval_secs)
+    : target_(move(target)), format_(format), interval_secs_(interval_secs)
+{
+    worker_ = thread([this]()
+                     {
+        unique_lock<mutex> lock(mutex_);
+        while (!stopping_)
+        {
+            wake_.wait_for(lock, chrono::duration<double>(interval_secs_), [this]
+                           { return stopping_; });
+            if (stopping_)
+                break;
+            lock.unlock();
+            flush();
+            lock.lock();
+        } });
+}
+
+void MetricsReporter::stop()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (stopping_)
+            return;
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+    flush();
+}
+
+static bool writeToSocket(const string &path, const string &data)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        return false;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    bool ok = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    size_t written = 0;
+    while (ok && written < data.size())
+    {
+        ssize_t n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        ok = n > 0;
+        if (ok)
+            written += n;
+    }
+    close(fd);
+    return ok;
+}
+
+bool MetricsReporter::flush()
+{
+    string data = metrics().render(format_);
+    const string prefix = "unix:";
+    if (target_.compare(0, prefix.size(), prefix) == 0)
+    {
+        // 收集端不在时不报错刷屏，下个周期再试
+        return writeToSocket(target_.substr(prefix.size()), data);
+    }
+
+    string tmp = target_ + ".tmp";
+    {
+        ofstream outFile(tmp, ios::binary | ios::trunc);
+        outFile << data;
+        if (!outFile)
+        {
+            cerr << "Error: Could not write metrics to " << tmp << endl;
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), target_.c_str()) != 0)
+    {
+        cerr << "Error: Could not rename " << tmp << " to " << target_ << ": " << strerror(errno) << endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 运行时指标：计数器、仪表和直方图。
+// 热路径上的更新只是对本线程所在分片做一次 relaxed 原子加，不加锁、不分配内存；
+// 各分片按缓存行对齐，不同线程互不争用。导出时才把所有分片加起来。
+// 注册（创建指标）需要加锁，应在进入循环前完成，把返回的引用保存下来复用。
+
+const int metric_shards = 16;
+
+// 当前线程使用的分片号：每个线程第一次调用时轮流分配
+int metricShard();
+
+struct alignas(64) MetricCell
+{
+    std::atomic<uint64_t> value{0};
+};
+
+// 只增不减的计数器
+class Counter
+{
+public:
+    void add(uint64_t n = 1) { cells_[metricShard()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const;
+
+private:
+    MetricCell cells_[metric_shards];
+};
+
+// 可任意设置的当前值，例如队列深度、每个 epoch 的损失
+class Gauge
+{
+public:
+    void set(double v) { value_.store(v, std::memory_order_relaxed); }
+    void add(double v);
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+// 耗时直方图，单位为秒。桶上界从 1 微秒起每档翻倍，共 metric_buckets 档，
+// 再加一个 +Inf 桶；总和以纳秒整数累加，避免浮点 CAS
+const int metric_buckets = 24;
+
+class Histogram
+{
+public:
+    void observe(double seconds);
+    static double bucketBound(int b) { return 1e-6 * (double)(1u << b); }
+
+    struct Snapshot
+    {
+        uint64_t counts[metric_buckets + 1] = {}; // 各桶自身的计数（非累积）
+        uint64_t count = 0;
+        double sum = 0.0;
+    };
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> counts[metric_buckets + 1] = {};
+        std::atomic<uint64_t> sum_ns{0};
+    };
+    Shard shards_[metric_shards];
+};
+
+enum class MetricsFormat
+{
+    Prometheus,
+    Json,
+};
+
+// 全部指标的登记表。指标一经创建地址不变，直到进程退出
+class MetricsRegistry
+{
+public:
+    Counter &counter(const std::string &name, const std::string &help);
+    Gauge &gauge(const std::string &name, const std::string &help);
+    Histogram &histogram(const std::string &name, const std::string &help);
+    // 导出时才调用 fn 取值，适合已有统计（如缓存命中数）
+    void gaugeFunction(const std::string &name, const std::string &help, std::function<double()> fn);
+
+    std::string render(MetricsFormat format) const;
+
+private:
+    enum class Kind
+    {
+        Counter,
+        Gauge,
+        Histogram,
+        Function,
+    };
+    struct Entry
+    {
+        std::string name;
+        std::string help;
+        Kind kind;
+        void *metric;
+        std::function<double()> fn;
+    };
+    void *find(const std::string &name, Kind kind) const;
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+    std::deque<Counter> counters_;
+    std::deque<Gauge> gauges_;
+    std::deque<Histogram> histograms_;
+};
+
+// 进程内唯一的登记表
+MetricsRegistry &metrics();
+
+// 解析 --metrics-format 的取值
+bool parseMetricsFormat(const std::string &text, MetricsFormat &format);
+
+// 后台线程按固定间隔导出全部指标，析构或 stop() 时再导出最后一次。
+// target 为 "unix:/path" 时连接该 Unix 域套接字写入一份快照后关闭；
+// 否则写到普通文件：先写 .tmp 再 rename，读取方不会看到写了一半的内容
+class MetricsReporter
+{
+public:
+    MetricsReporter(std::string target, MetricsFormat format, double interval_secs);
+    ~MetricsReporter() { stop(); }
+
+    void stop();
+    bool flush();
+
+private:
+    std::string target_;
+    MetricsFormat format_;
+    double interval_secs_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,289 @@
+#include "core/model_io.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+static void writeFlags(ofstream &outFile, uint32_t flags)
+{
+    outFile.write(model_flags_magic, sizeof(model_flags_magic));
+    outFile.write(reinterpret_cast<const char *>(&flags), sizeof(flags));
+}
+
+void saveModel(const Layer &inputToHidden, const Layer &hiddenToOutput, const string &filename, uint32_t flags)
+{
+    ofstream outFile(filename, ios::binary);
+    if (!outFile)
+    {
+        cerr << "Error: Could not open file " << filename << " for writing." << endl;
+        return;
+    }
+    writeFlags(outFile, flags);
+
+    // 依次保存输入到隐藏层、隐藏到输出层的权重和偏置
+    for (const Layer *layer : {&inputToHidden, &hiddenToOutput})
+    {
+        uint32_t weights_size = layer->weights.size();
+        uint32_t biases_size = layer->biases.size();
+        outFile.write(reinterpret_cast<const char *>(&weights_size), sizeof(weights_size));
+        outFile.write(reinterpret_cast<const char *>(&biases_size), sizeof(biases_size));
+        outFile.write(reinterpret_cast<const char *>(layer->weights.data()), weights_size * sizeof(float));
+        outFile.write(reinterpret_cast<const char *>(layer->biases.data()), biases_size * sizeof(float));
+    }
+
+    outFile.close();
+    cout << "Model saved to " << filename << endl;
+}
+
+void saveHalfModel(const Layer &inputToHidden, const Layer &hiddenToOutput,
+                   const string &filename, HalfFormat format, uint32_t flags)
+{
+    ofstream outFile(filename, ios::binary);
+    if (!outFile)
+    {
+        cerr << "Error: Could not open file " << filename << " for writing." << endl;
+        return;
+    }
+    writeFlags(outFile, flags);
+
+    outFile.write(half_model_magic, sizeof(half_model_magic));
+    uint32_t format_id = (uint32_t)format;
+    outFile.write(reinterpret_cast<const char *>(&format_id), sizeof(format_id));
+    for (const Layer *layer : {&inputToHidden, &hiddenToOutput})
+    {
+        uint32_t weights_size = layer->weights.size();
+        uint32_t biases_size = layer->biases.size();
+        vector<uint16_t> half(weights_size);
+        convertToHalf(layer->weights.data(), half.data(), weights_size, format);
+        outFile.write(reinterpret_cast<const char *>(&weights_size), sizeof(weights_size));
+        outFile.write(reinterpret_cast<const char *>(&biases_size), sizeof(biases_size));
+        outFile.write(reinterpret_cast<const char *>(half.data()), weights_size * sizeof(uint16_t));
+        outFile.write(reinterpret_cast<const char *>(layer->biases.data()), biases_size * sizeof(float));
+    }
+
+    outFile.close();
+    cout << "Half-precision model saved to " << filename << endl;
+}
+
+bool saveSparseModel(const Layer &inputToHidden, const Layer &hiddenToOutput, const string &filename, uint32_t flags)
+{
+    ofstream outFile(filename, ios::binary);
+    if (!outFile)
+    {
+        cerr << "Error: Could not open file " << filename << " for writing." << endl;
+        return false;
+    }
+    writeFlags(outFile, flags);
+
+    uint32_t hidden_size = inputToHidden.biases.size();
+    uint32_t header[4] = {sparse_model_version, (uint32_t)input_size, hidden_size, (uint32_t)output_size};
+    uint32_t nnz = inputToHidden.weights.size();
+    outFile.write(sparse_model_magic, sizeof(sparse_model_magic));
+    outFile.write(reinterpret_cast<const char *>(header), sizeof(header));
+    outFile.write(reinterpret_cast<const char *>(&nnz), sizeof(nnz));
+    outFile.write(reinterpret_cast<const char *>(inputToHidden.row_ptr.data()), inputToHidden.row_ptr.size() * sizeof(uint32_t));
+    outFile.write(reinterpret_cast<const char *>(inputToHidden.cols.data()), nnz * sizeof(uint16_t));
+    outFile.write(reinterpret_cast<const char *>(inputToHidden.weights.data()), nnz * sizeof(float));
+    outFile.write(reinterpret_cast<const char *>(inputToHidden.biases.data()), hidden_size * sizeof(float));
+
+    uint32_t weights_size = hiddenToOutput.weights.size();
+    uint32_t biases_size = hiddenToOutput.biases.size();
+    outFile.write(reinterpret_cast<const char *>(&weights_size), sizeof(weights_size));
+    outFile.write(reinterpret_cast<const char *>(&biases_size), sizeof(biases_size));
+    outFile.write(reinterpret_cast<const char *>(hiddenToOutput.weights.data()), weights_size * sizeof(float));
+    outFile.write(reinterpret_cast<const char *>(hiddenToOutput.biases.data()), biases_size * sizeof(float));
+
+    outFile.close();
+    if (!outFile)
+    {
+        cerr << "Error: Failed to write " << filename << endl;
+        return false;
+    }
+    cout << "Sparse model saved to " << filename << endl;
+    return true;
+}
+
+// 流中剩余的字节数；流不可定位时返回 -1
+static streamoff remainingBytes(istream &inFile)
+{
+    streampos here = inFile.tellg();
+    if (here < 0 || !inFile.seekg(0, ios::end))
+    {
+        inFile.clear();
+        return -1;
+    }
+    streamoff remaining = inFile.tellg() - here;
+    inFile.seekg(here);
+    return remaining;
+}
+
+bool readLayer(istream &inFile, Layer &layer, size_t fan_in, uint32_t half_format)
+{
+    uint32_t weights_size = 0, biases_size = 0;
+    inFile.read(reinterpret_cast<char *>(&weights_size), sizeof(weights_size));
+    inFile.read(reinterpret_cast<char *>(&biases_size), sizeof(biases_size));
+    if (!inFile)
+        return false;
+    // 尺寸来自文件，先与层的形状和文件剩余长度核对，损坏的文件不能让 resize 分配几 GB
+    size_t weight_bytes = half_format ? sizeof(uint16_t) : sizeof(float);
+    streamoff remaining = remainingBytes(inFile);
+    if (biases_size == 0 || biases_size > 65536 || fan_in == 0 || fan_in > 65536 ||
+        weights_size != fan_in * biases_size ||
+        (remaining >= 0 && (uint64_t)remaining < weights_size * weight_bytes + biases_size * sizeof(float)))
+        return false;
+    layer.biases.resize(biases_size);
+    layer.half_format = half_format;
+    if (half_format)
+    {
+        layer.weights.clear();
+        layer.half_weights.resize(weights_size);
+        inFile.read(reinterpret_cast<char *>(layer.half_weights.data()), weights_size * sizeof(uint16_t));
+    }
+    else
+    {
+        layer.half_weights.clear();
+        layer.weights.resize(weights_size);
+        inFile.read(reinterpret_cast<char *>(layer.weights.data()), weights_size * sizeof(float));
+    }
+    inFile.read(reinterpret_cast<char *>(layer.biases.data()), biases_size * sizeof(float));
+    return (bool)inFile;
+}
+
+void expandHalfWeights(Layer &layer)
+{
+    if (!layer.half_format)
+        return;
+    layer.weights.resize(layer.half_weights.size());
+    convertToFloat(layer.half_weights.data(), layer.weights.data(), layer.weights.size(), (HalfFormat)layer.half_format);
+    vector<uint16_t>().swap(layer.half_weights);
+    layer.half_format = 0;
+}
+
+size_t weightCount(const Layer &layer)
+{
+    return layer.half_format ? layer.half_weights.size() : layer.weights.size();
+}
+
+static bool readSparseLayer(ifstream &inFile, Layer &layer)
+{
+    uint32_t header[4] = {}, nnz = 0;
+    inFile.read(reinterpret_cast<char *>(header), sizeof(header));
+    inFile.read(reinterpret_cast<char *>(&nnz), sizeof(nnz));
+    uint32_t hidden_size = header[2];
+    if (!inFile || header[0] != sparse_model_version || header[1] != (uint32_t)input_size ||
+        hidden_size == 0 || hidden_size > 65536 || header[3] != (uint32_t)output_size ||
+        nnz > (uint32_t)input_size * hidden_size)
+        return false;
+    layer.row_ptr.resize(hidden_size + 1);
+    layer.cols.resize(nnz);
+    layer.weights.resize(nnz);
+    layer.biases.resize(hidden_size);
+    inFile.read(reinterpret_cast<char *>(layer.row_ptr.data()), layer.row_ptr.size() * sizeof(uint32_t));
+    inFile.read(reinterpret_cast<char *>(layer.cols.data()), nnz * sizeof(uint16_t));
+    inFile.read(reinterpret_cast<char *>(layer.weights.data()), nnz * sizeof(float));
+    inFile.read(reinterpret_cast<char *>(layer.biases.data()), hidden_size * sizeof(float));
+    if (!inFile || layer.row_ptr[0] != 0 || layer.row_ptr[hidden_size] != nnz)
+        return false;
+    for (uint32_t h = 0; h < hidden_size; h++)
+    {
+        if (layer.row_ptr[h] > layer.row_ptr[h + 1])
+            return false;
+    }
+    for (uint16_t c : layer.cols)
+    {
+        if (c >= input_size)
+            return false;
+    }
+    return true;
+}
+
+bool loadModel(Layer &inputToHidden, Layer &hiddenToOutput, const string &filename, ModelInfo *info)
+{
+    ifstream inFile(filename, ios::binary);
+    if (!inFile)
+    {
+        cerr << "Error: Could not open file " << filename << " for reading." << endl;
+        return false;
+    }
+
+    inputToHidden = Layer();
+    hiddenToOutput = Layer();
+
+    char magic[4] = {};
+    uint32_t half_format = 0;
+    bool sparse = false;
+    ModelInfo header;
+    inFile.read(magic, sizeof(magic));
+    if (inFile && memcmp(magic, model_flags_magic, sizeof(magic)) == 0)
+    {
+        header.has_flags = true;
+        inFile.read(reinterpret_cast<char *>(&header.flags), sizeof(header.flags));
+        inFile.read(magic, sizeof(magic));
+        if (!inFile)
+        {
+            cerr << "Error: Model file " << filename << " is truncated." << endl;
+            return false;
+        }
+    }
+    streampos body = header.has_flags ? streampos(sizeof(model_flags_magic) + sizeof(header.flags)) : streampos(0);
+    if (inFile && memcmp(magic, sparse_model_magic, sizeof(magic)) == 0)
+    {
+        sparse = true;
+    }
+    else if (inFile && memcmp(magic, half_model_magic, sizeof(magic)) == 0)
+    {
+        inFile.read(reinterpret_cast<char *>(&half_format), sizeof(half_format));
+        if (half_format != (uint32_t)HalfFormat::BF16 && half_format != (uint32_t)HalfFormat::FP16)
+        {
+            cerr << "Error: Unknown half-precision format in " << filename << endl;
+            return false;
+        }
+    }
+    else
+    {
+        inFile.clear();
+        inFile.seekg(body);
+    }
+
+    bool ok = sparse ? readSparseLayer(inFile, inputToHidden) : readLayer(inFile, inputToHidden, input_size, half_format);
+    ok = ok && readLayer(inFile, hiddenToOutput, inputToHidden.biases.size(), half_format);
+    size_t hidden_size = inputToHidden.biases.size();
+    if (!ok || hidden_size == 0 ||
+        (!sparse && weightCount(inputToHidden) != input_size * hidden_size) ||
+        weightCount(hiddenToOutput) != hidden_size * output_size ||
+        hiddenToOutput.biases.size() != (size_t)output_size)
+    {
+        cerr << "Error: Model file " << filename << " is corrupt or has unexpected layer sizes." << endl;
+        return false;
+    }
+
+    inFile.close();
+    // 状态信息写到 stderr，stdout 只留给结果
+    cerr << "Model loaded from " << filename << " (hidden " << hidden_size;
+    if (sparse)
+        cerr << ", " << inputToHidden.weights.size() << " non-zeros";
+    else if (half_format)
+        cerr << ", " << (half_format == (uint32_t)HalfFormat::BF16 ? "bf16" : "fp16");
+    if (header.flags & model_flag_preprocess)
+        cerr << ", preprocessed inputs";
+    cerr << ")" << endl;
+    if (info)
+        *info = header;
+    return true;
+}
+
+bool applyModelPreprocess(const ModelInfo &info, bool &preprocess, const string &filename)
+{
+    if (!info.has_flags)
+        return true;
+    bool trained_with = info.flags & model_flag_preprocess;
+    if (preprocess && !trained_with)
+    {
+        cerr << "Error: " << filename << " was trained without --preprocess; drop --preprocess." << endl;
+        return false;
+    }
+    preprocess = trained_with;
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "core/half.h"
+#include "core/network.h"
+
+// 模型文件格式：
+//   fp32 模型（saveModel）：每层依次为 [权重数][偏置数][fp32 权重][fp32 偏置]
+//   "DGHP" 半精度模型：魔数 + 格式，随后每层为 [权重数][偏置数][16 位权重][fp32 偏置]
+//   "DGSP" 稀疏模型：魔数 + [版本][输入][隐藏][输出] + CSR 形式的 inputToHidden
+//     （nnz、row_ptr、cols、values、biases），其后的 hiddenToOutput 与 fp32 模型相同
+// 保存时三种格式前都加 "DGMF" 头：魔数 + [标志]，记录推理时必须与训练一致的设置（见 model_flag_*）。
+// 没有这个头的旧文件照常读取，只是不知道这些设置
+const char half_model_magic[4] = {'D', 'G', 'H', 'P'};
+const char sparse_model_magic[4] = {'D', 'G', 'S', 'P'};
+const char model_flags_magic[4] = {'D', 'G', 'M', 'F'};
+const uint32_t sparse_model_version = 1;
+const uint32_t model_flag_preprocess = 1; // 训练时输入经过 preprocessDigit
+
+// loadModel 从文件头读出的附加信息
+struct ModelInfo
+{
+    bool has_flags = false; // 旧文件没有 "DGMF" 头
+    uint32_t flags = 0;
+};
+
+// 保存模型到文件；flags 为 model_flag_* 的组合
+void saveModel(const Layer &inputToHidden, const Layer &hiddenToOutput, const std::string &filename,
+               uint32_t flags = 0);
+
+// 导出半精度模型
+void saveHalfModel(const Layer &inputToHidden, const Layer &hiddenToOutput,
+                   const std::string &filename, HalfFormat format, uint32_t flags = 0);
+
+// 保存稀疏模型，inputToHidden 需已压缩为 CSR
+bool saveSparseModel(const Layer &inputToHidden, const Layer &hiddenToOutput, const std::string &filename,
+                     uint32_t flags = 0);
+
+// 读取一层：[权重数][偏置数][权重][fp32 偏置]；half_format 为 0 表示 fp32 权重，否则为 HalfFormat，
+// 此时权重原样读入 half_weights。检查点等其他文件格式也按这种方式存放各层。
+// fan_in 为该层的输入数：权重数必须等于 fan_in * 偏置数，且不超过文件剩余长度，否则不分配内存直接返回 false
+bool readLayer(std::istream &inFile, Layer &layer, size_t fan_in, uint32_t half_format = 0);
+
+// 半精度权重展开为 fp32（训练、剪枝等需要修改权重时）；fp32 层不变
+void expandHalfWeights(Layer &layer);
+
+// 层的权重个数，fp32 与半精度均可
+size_t weightCount(const Layer &layer);
+
+// 加载模型：自动识别以上三种格式。半精度权重保持 16 位，由推理函数逐行展开，内存占用减半。
+// 隐藏层大小由文件决定，即 inputToHidden.biases.size()。info 非空时填入文件头中的标志
+bool loadModel(Layer &inputToHidden, Layer &hiddenToOutput, const std::string &filename,
+               ModelInfo *info = nullptr);
+
+// 按模型记录的设置决定是否预处理输入：模型要求预处理时自动打开 preprocess；
+// 模型记录为未预处理而命令行给了 --preprocess 时报错返回 false。旧文件沿用命令行
+bool applyModelPreprocess(const ModelInfo &info, bool &preprocess, const std::string &filename);
@@ -0,0 +1,305 @@
+#include "core/network.h"
+
+#include "core/half.h"
+
+#include <algorithm>
+
+using namespace std;
+
+ForwardResult forwardPropagation(const vector<float> &input,
+                                 const Layer &inputToHidden,
+                                 const Layer &hiddenToOutput)
+{
+    const int hidden_size = inputToHidden.biases.size();
+    ForwardResult result;
+    result.hidden.resize(hidden_size);
+    result.hidden_z.resize(hidden_size);
+    result.output.resize(output_size);
+    result.output_z.resize(output_size);
+
+    // 1. 输入层到隐藏层
+    for (int h = 0; h < hidden_size; h++)
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < input_size; i++)
+        {
+            sum += input[i] * inputToHidden.weights[i + h * input_size];
+        }
+        result.hidden_z[h] = sum + inputToHidden.biases[h];
+        result.hidden[h] = sigmoid(result.hidden_z[h]);
+    }
+
+    // 2. 隐藏层到输出层
+    for (int o = 0; o < output_size; o++)
+    {
+        float sum = 0.0f;
+        for (int h = 0; h < hidden_size; h++)
+        {
+            sum += result.hidden[h] * hiddenToOutput.weights[h + o * hidden_size];
+        }
+        result.output_z[o] = sum + hiddenToOutput.biases[o];
+        result.output[o] = sigmoid(result.output_z[o]);
+    }
+
+    return result;
+}
+
+vector<float> outputDelta(const ForwardResult &forward_result, const vector<float> &target)
+{
+    vector<float> output_delta(output_size);
+    for (int o = 0; o < output_size; o++)
+    {
+        float error = forward_result.output[o] - target[o]; // 均方误差的导数
+        output_delta[o] = error * sigmoid_derivative(forward_result.output_z[o]);
+    }
+    return output_delta;
+}
+
+void backwardPropagation(const vector<float> &input,
+                         const ForwardResult &forward_result,
+                         const vector<float> &target,
+                         Layer &inputToHidden,
+                         Layer &hiddenToOutput,
+                         float lr)
+{
+    // 1. 计算输出层误差，其余步骤见 backwardFromDelta
+    backwardFromDelta(input, forward_result, outputDelta(forward_result, target), inputToHidden, hiddenToOutput, lr);
+}
+
+void backwardFromDelta(const vector<float> &input,
+                       const ForwardResult &forward_result,
+                       const vector<float> &output_delta,
+                       Layer &inputToHidden,
+                       Layer &hiddenToOutput,
+                       float lr)
+{
+    const int hidden_size = inputToHidden.biases.size();
+
+    // 2. 计算隐藏层误差
+    vector<float> hidden_delta(hidden_size);
+    for (int h = 0; h < hidden_size; h++)
+    {
+        float error = 0.0f;
+        for (int o = 0; o < output_size; o++)
+        {
+            error += output_delta[o] * hiddenToOutput.weights[h + o * hidden_size];
+        }
+        hidden_delta[h] = error * sigmoid_derivative(forward_result.hidden_z[h]);
+    }
+
+    // 3. 更新隐藏层到输出层的权重和偏置
+    for (int o = 0; o < output_size; o++)
+    {
+        for (int h = 0; h < hidden_size; h++)
+        {
+            float grad = output_delta[o] * forward_result.hidden[h];
+            hiddenToOutput.weights[h + o * hidden_size] -= lr * grad;
+        }
+        hiddenToOutput.biases[o] -= lr * output_delta[o];
+    }
+
+    // 4. 更新输入层到隐藏层的权重和偏置
+    for (int h = 0; h < hidden_size; h++)
+    {
+        for (int i = 0; i < input_size; i++)
+        {
+            float grad = hidden_delta[h] * input[i];
+            inputToHidden.weights[i + h * input_size] -= lr * grad;
+        }
+        inputToHidden.biases[h] -= lr * hidden_delta[h];
+    }
+}
+
+vector<float> getTarget(int label)
+{
+    vector<float> target(output_size, 0.0f);
+    target[label] = 1.0f;
+    return target;
+}
+
+// 第 r 行权重（每行 n 个）：fp32 直接返回；半精度展开到 buf 中，一行只在 L1 里停留一次
+static inline const float *weightRow(const Layer &layer, int r, int n, float *buf)
+{
+    if (!layer.half_format)
+        return layer.weights.data() + (size_t)r * n;
+    convertToFloat(layer.half_weights.data() + (size_t)r * n, buf, n, (HalfFormat)layer.half_format);
+    return buf;
+}
+
+// 第 h 个隐藏单元的加权和；稀疏模型只累加保留下来的连接
+static inline float hiddenSum(const float *input, const Layer &inputToHidden, int h, float *buf)
+{
+    float sum = 0.0f;
+    if (!inputToHidden.row_ptr.empty())
+    {
+        for (uint32_t k = inputToHidden.row_ptr[h]; k < inputToHidden.row_ptr[h + 1]; k++)
+        {
+            sum += input[inputToHidden.cols[k]] * inputToHidden.weights[k];
+        }
+        return sum;
+    }
+    const float *row = weightRow(inputToHidden, h, input_size, buf);
+    for (int i = 0; i < input_size; i++)
+    {
+        sum += input[i] * row[i];
+    }
+    return sum;
+}
+
+vector<float> predict(const float *input,
+                      const Layer &inputToHidden,
+                      const Layer &hiddenToOutput)
+{
+    const int hidden_size = inputToHidden.biases.size();
+    vector<float> hidden(hidden_size);
+    vector<float> buf(max(input_size, hidden_size));
+    for (int h = 0; h < hidden_size; h++)
+    {
+        hidden[h] = sigmoid(hiddenSum(input, inputToHidden, h, buf.data()) + inputToHidden.biases[h]);
+    }
+
+    vector<float> output(output_size);
+    for (int o = 0; o < output_size; o++)
+    {
+        const float *row = weightRow(hiddenToOutput, o, hidden_size, buf.data());
+        float sum = 0.0f;
+        for (int h = 0; h < hidden_size; h++)
+        {
+            sum += hidden[h] * row[h];
+        }
+        output[o] = sigmoid(sum + hiddenToOutput.biases[o]);
+    }
+
+    return output;
+}
+
+// 批量推理：每组 batch_lanes 个样本，沿批方向向量化；每次同时算 batch_rows 个隐藏单元，
+// 几条互不依赖的累加链掩盖浮点加法的延迟
+const int batch_lanes = 16;
+const int batch_rows = 4;
+
+void predictBatch(const float *inputs, int count,
+                  const Layer &inputToHidden,
+                  const Layer &hiddenToOutput,
+                  float *outputs)
+{
+    const int hidden_size = inputToHidden.biases.size();
+    const bool sparse = !inputToHidden.row_ptr.empty();
+    vector<float> buf((size_t)batch_rows * max(input_size, hidden_size));
+    vector<float> xt((size_t)input_size * batch_lanes);  // xt[i * batch_lanes + b]
+    vector<float> ht((size_t)hidden_size * batch_lanes); // ht[h * batch_lanes + b]
+    for (int b0 = 0; b0 < count; b0 += batch_lanes)
+    {
+        // 转置一组输入，让同一像素的 batch_lanes 个值相邻；不足一组的补 0
+        const int n = min(batch_lanes, count - b0);
+        for (int b = 0; b < batch_lanes; b++)
+        {
+            const float *x = inputs + (size_t)(b0 + b) * input_size;
+            for (int i = 0; i < input_size; i++)
+                xt[(size_t)i * batch_lanes + b] = b < n ? x[i] : 0.0f;
+        }
+
+        // 每个权重读一次，最内层沿批方向累加。每个样本的累加顺序与 predict 相同，
+        // 差别只在编译器是否把乘加合并为 FMA（约 1e-6 的舍入差）
+        for (int h0 = 0; h0 < hidden_size; h0 += batch_rows)
+        {
+            const int rows = min(batch_rows, hidden_size - h0);
+            float acc[batch_rows][batch_lanes] = {};
+            if (sparse)
+            {
+                for (int r = 0; r < rows; r++)
+                {
+                    for (uint32_t k = inputToHidden.row_ptr[h0 + r]; k < inputToHidden.row_ptr[h0 + r + 1]; k++)
+                    {
+                        const float w = inputToHidden.weights[k];
+                        const float *xi = xt.data() + (size_t)inputToHidden.cols[k] * batch_lanes;
+#pragma omp simd
+                        for (int b = 0; b < batch_lanes; b++)
+                            acc[r][b] += xi[b] * w;
+                    }
+                }
+            }
+            else
+            {
+                // 最后不足 batch_rows 行时重复最后一行，多算的结果丢弃
+                const float *row[batch_rows];
+                for (int r = 0; r < batch_rows; r++)
+                    row[r] = weightRow(inputToHidden, h0 + min(r, rows - 1), input_size, buf.data() + (size_t)r * input_size);
+                for (int i = 0; i < input_size; i++)
+                {
+                    const float *xi = xt.data() + (size_t)i * batch_lanes;
+                    const float w0 = row[0][i], w1 = row[1][i], w2 = row[2][i], w3 = row[3][i];
+#pragma omp simd
+                    for (int b = 0; b < batch_lanes; b++)
+                    {
+                        acc[0][b] += xi[b] * w0;
+                        acc[1][b] += xi[b] * w1;
+                        acc[2][b] += xi[b] * w2;
+                        acc[3][b] += xi[b] * w3;
+                    }
+                }
+            }
+            for (int r = 0; r < rows; r++)
+            {
+                for (int b = 0; b < batch_lanes; b++)
+                    ht[(size_t)(h0 + r) * batch_lanes + b] = sigmoid(acc[r][b] + inputToHidden.biases[h0 + r]);
+            }
+        }
+
+        for (int o = 0; o < output_size; o++)
+        {
+            const float *row = weightRow(hiddenToOutput, o, hidden_size, buf.data());
+            float acc[batch_lanes] = {};
+            for (int h = 0; h < hidden_size; h++)
+            {
+                const float *hh = ht.data() + (size_t)h * batch_lanes;
+#pragma omp simd
+                for (int b = 0; b < batch_lanes; b++)
+                    acc[b] += hh[b] * row[h];
+            }
+            for (int b = 0; b < n; b++)
+                outputs[(size_t)(b0 + b) * output_size + o] = sigmoid(acc[b] + hiddenToOutput.biases[o]);
+        }
+    }
+}
+
+vector<float> forwardLogits(const vector<float> &input,
+                            const Layer &inputToHidden,
+                            const Layer &hiddenToOutput)
+{
+    const int hidden_size = inputToHidden.biases.size();
+    vector<float> hidden(hidden_size);
+    vector<float> buf(max(input_size, hidden_size));
+    for (int h = 0; h < hidden_size; h++)
+    {
+        hidden[h] = sigmoid(hiddenSum(input.data(), inputToHidden, h, buf.data()) + inputToHidden.biases[h]);
+    }
+
+    vector<float> logits(output_size);
+    for (int o = 0; o < output_size; o++)
+    {
+        const float *row = weightRow(hiddenToOutput, o, hidden_size, buf.data());
+        float sum = 0.0f;
+        for (int h = 0; h < hidden_size; h++)
+        {
+            sum += hidden[h] * row[h];
+        }
+        logits[o] = sum + hiddenToOutput.biases[o];
+    }
+    return logits;
+}
+
+int getPredictedDigit(const vector<float> &output)
+{
+    int max_index = 0;
+    float max_value = output[0];
+    for (int i = 1; i < output_size; i++)
+    {
+        if (output[i] > max_value)
+        {
+            max_value = output[i];
+            max_index = i;
+        }
+    }
+    return max_index;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+const int input_size = 784;
+const int default_hidden_size = 256;
+const int output_size = 10;
+const float learning_rate = 0.01f;
+
+// 全连接层，weights[i + o * 输入数] 为输入 i 到输出 o 的权重。
+// 稀疏模型（prune 导出）的 inputToHidden 按行存为 CSR：row_ptr 非空时
+// weights 只保存非零值，cols 为对应的输入下标。
+// 半精度模型加载后权重保持 16 位：half_format 非 0（HalfFormat）时 weights 为空，
+// 权重在 half_weights 中，推理时逐行展开为 fp32
+struct Layer
+{
+    std::vector<float> weights;
+    std::vector<float> biases;
+    std::vector<uint32_t> row_ptr;
+    std::vector<uint16_t> cols;
+    std::vector<uint16_t> half_weights;
+    uint32_t half_format = 0;
+};
+
+inline float sigmoid(float x)
+{
+    return 1.0f / (1.0f + std::exp(-x));
+}
+
+inline float sigmoid_derivative(float x)
+{
+    float sig = sigmoid(x);
+    return sig * (1.0f - sig);
+}
+
+// 前向传播的中间结果，反向传播需要
+struct ForwardResult
+{
+    std::vector<float> hidden;   // 隐藏层输出
+    std::vector<float> output;   // 输出层输出
+    std::vector<float> hidden_z; // 隐藏层加权和（激活前）
+    std::vector<float> output_z; // 输出层加权和（激活前）
+};
+
+// 以下函数的隐藏层大小都取自 inputToHidden.biases.size()
+
+// 训练用前向传播（稠密 fp32 权重；半精度模型需先 expandHalfWeights）
+ForwardResult forwardPropagation(const std::vector<float> &input,
+                                 const Layer &inputToHidden,
+                                 const Layer &hiddenToOutput);
+
+// 反向传播：均方误差 + sigmoid，按 lr 做一步 SGD
+void backwardPropagation(const std::vector<float> &input,
+                         const ForwardResult &forward_result,
+                         const std::vector<float> &target,
+                         Layer &inputToHidden,
+                         Layer &hiddenToOutput,
+                         float lr = learning_rate);
+
+// 均方误差 + sigmoid 的输出层误差 (output - target) * sigmoid'(z)
+std::vector<float> outputDelta(const ForwardResult &forward_result, const std::vector<float> &target);
+
+// 从输出层误差（对 output_z 的梯度）开始反向传播并做一步 SGD；
+// 损失不是普通均方误差时（例如蒸馏）先自行算出 output_delta
+void backwardFromDelta(const std::vector<float> &input,
+                       const ForwardResult &forward_result,
+                       const std::vector<float> &output_delta,
+                       Layer &inputToHidden,
+                       Layer &hiddenToOutput,
+                       float lr = learning_rate);
+
+// one-hot 训练目标
+std::vector<float> getTarget(int label);
+
+// 推理用前向传播，只返回输出层；稠密、半精度与 CSR 稀疏模型均可
+std::vector<float> predict(const float *input,
+                           const Layer &inputToHidden,
+                           const Layer &hiddenToOutput);
+
+inline std::vector<float> predict(const std::vector<float> &input,
+                                  const Layer &inputToHidden,
+                                  const Layer &hiddenToOutput)
+{
+    return predict(input.data(), inputToHidden, hiddenToOutput);
+}
+
+// 批量推理：inputs 为 count 个连续样本，outputs 写入 count * output_size 个值。
+// 样本按 16 个一组转置，每个权重读入一次后沿批方向向量化累加；与逐个 predict 的累加顺序相同
+void predictBatch(const float *inputs, int count,
+                  const Layer &inputToHidden,
+                  const Layer &hiddenToOutput,
+                  float *outputs);
+
+// 输出层激活前的值（蒸馏的软目标需要）
+std::vector<float> forwardLogits(const std::vector<float> &input,
+                                 const Layer &inputToHidden,
+                                 const Layer &hiddenToOutput);
+
+// 找到输出中最大值的索引
+int getPredictedDigit(const std::vector<float> &output);
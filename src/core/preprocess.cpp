@@ -0,0 +1,153 @@
+#include "core/preprocess.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+const int side = 28;
+const int padded = side + 2;       // 四周各补一圈 0，双线性插值不必判断越界
+const float box_size = 20.0f;      // 包围盒长边缩放到的像素数
+const float center = (side - 1) * 0.5f;
+const float min_mass = 1.0f;       // 墨迹总量低于此值视为空白
+const float stroke_ink = 0.25f;    // 参与矩与包围盒统计的最小墨迹，过滤浅色噪点
+const float box_quantile = 0.01f;  // 包围盒两端各舍去的墨迹比例
+const int shear_bins = 3 * side;   // 去倾斜后横坐标范围为 [-side, 2 * side)
+
+// 在累积分布中找到质量首次超过 lo / 最后低于 hi 的下标
+static void quantileRange(const float *hist, int n, float total, int &first, int &last)
+{
+    float lo = total * box_quantile, hi = total * (1.0f - box_quantile);
+    float cumulative = 0.0f;
+    first = -1;
+    last = n - 1;
+    for (int i = 0; i < n; i++)
+    {
+        cumulative += hist[i];
+        if (first < 0 && cumulative > lo)
+            first = i;
+        if (cumulative >= hi)
+        {
+            last = i;
+            break;
+        }
+    }
+    if (first < 0)
+        first = 0;
+}
+
+void preprocessDigit(const float *in, float *out)
+{
+    alignas(64) float ink[padded * padded] = {};
+    alignas(64) float xs[side];
+    for (int x = 0; x < side; x++)
+        xs[x] = (float)x;
+
+    // 1) 墨迹与逐行的质量、一阶矩；矩只统计不低于 stroke_ink 的像素，浅色噪点不影响质心。
+    //    内层循环定长 28，编译器可向量化
+    float row_mass[side], row_x[side];
+    for (int y = 0; y < side; y++)
+    {
+        const float *src = in + y * side;
+        float *dst = ink + (y + 1) * padded + 1;
+        float m = 0.0f, mx = 0.0f;
+        for (int x = 0; x < side; x++)
+        {
+            float v = 1.0f - src[x];
+            v = v > 0.0f ? v : 0.0f;
+            dst[x] = v;
+            float w = v >= stroke_ink ? v : 0.0f;
+            m += w;
+            mx += w * xs[x];
+        }
+        row_mass[y] = m;
+        row_x[y] = mx;
+    }
+
+    float m00 = 0.0f, m10 = 0.0f, m01 = 0.0f, m11 = 0.0f, m02 = 0.0f;
+    for (int y = 0; y < side; y++)
+    {
+        m00 += row_mass[y];
+        m10 += row_x[y];
+        m01 += y * row_mass[y];
+        m11 += y * row_x[y];
+        m02 += (float)y * y * row_mass[y];
+    }
+    if (m00 < min_mass)
+    {
+        if (out != in)
+            copy(in, in + side * side, out);
+        return;
+    }
+    float cx = m10 / m00, cy = m01 / m00;
+    float mu11 = m11 / m00 - cx * cy;
+    float mu02 = m02 / m00 - cy * cy;
+    float skew = mu02 > 1e-3f ? mu11 / mu02 : 0.0f;
+    skew = min(1.0f, max(-1.0f, skew));
+
+    // 2) 去倾斜后的包围盒：纵向直接用逐行质量，横向把每个像素按剪切后的坐标分箱
+    float cols[shear_bins] = {};
+    for (int y = 0; y < side; y++)
+    {
+        if (row_mass[y] == 0.0f)
+            continue;
+        float shift = side - skew * (y - cy) + 0.5f; // 剪切后的 x 加上偏移 side，四舍五入到箱
+        const float *row = ink + (y + 1) * padded + 1;
+        for (int x = 0; x < side; x++)
+        {
+            if (row[x] >= stroke_ink)
+            {
+                int bin = (int)(x + shift);
+                cols[min(shear_bins - 1, max(0, bin))] += row[x];
+            }
+        }
+    }
+    int x0, x1, y0, y1;
+    quantileRange(cols, shear_bins, m00, x0, x1);
+    quantileRange(row_mass, side, m00, y0, y1);
+    float width = (float)(x1 - x0 + 1), height = (float)(y1 - y0 + 1);
+    float scale = box_size / max(width, height);
+    scale = min(4.0f, max(0.25f, scale));
+    float inv = 1.0f / scale;
+
+    // 3) 反向映射：输出 (u, v) -> 去倾斜坐标 (cx + (u - c) / s, cy + (v - c) / s)
+    //    -> 原图 (x' + skew * (y - cy), y)。每个输出行先在两行源像素间做纵向插值
+    //    （整行定长，可向量化），再沿横向插值
+    alignas(64) float blended[padded];
+    for (int v = 0; v < side; v++)
+    {
+        float *dst = out + v * side;
+        float sy = cy + (v - center) * inv;
+        if (sy <= -1.0f || sy >= side)
+        {
+            fill(dst, dst + side, 1.0f);
+            continue;
+        }
+        float fy0 = floor(sy);
+        float fy = sy - fy0;
+        const float *r0 = ink + ((int)fy0 + 1) * padded;
+        const float *r1 = r0 + padded;
+        for (int x = 0; x < padded; x++)
+            blended[x] = r0[x] + fy * (r1[x] - r0[x]);
+
+        float sx = cx + skew * (sy - cy) - center * inv;
+        for (int u = 0; u < side; u++, sx += inv)
+        {
+            float value = 0.0f;
+            if (sx > -1.0f && sx < side)
+            {
+                float fx0 = floor(sx);
+                float fx = sx - fx0;
+                int i = (int)fx0 + 1;
+                value = blended[i] + fx * (blended[i + 1] - blended[i]);
+            }
+            dst[u] = 1.0f - value;
+        }
+    }
+}
+
+void preprocessBatch(float *images, size_t count)
+{
+    for (size_t n = 0; n < count; n++)
+        preprocessDigit(images + n * side * side, images + n * side * side);
+}
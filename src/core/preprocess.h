@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+// 输入预处理：训练与推理共用，保证两边看到的图片分布一致。
+// 像素为 0-1 的 28x28 图片，背景为 1（白），笔画为暗色，与 BMP 归一化后的约定相同。
+//
+// 步骤（一次重采样完成）：
+//   1. 以 1 - 像素 为墨迹权重计算图像矩：质心与二阶中心矩（忽略很浅的像素）
+//   2. 去倾斜：按 mu11 / mu02 做水平剪切，使笔画主轴竖直
+//   3. 在去倾斜后的坐标中求笔画的包围盒（按墨迹质量的分位数，忽略零星噪点），
+//      等比缩放使长边为 20 像素
+//   4. 平移使质心落在 28x28 的中心，双线性插值得到输出
+// 空白图片原样输出。in 与 out 可以是同一块内存
+void preprocessDigit(const float *in, float *out);
+
+// 对 count 张连续存放的图片逐张预处理（原地）
+void preprocessBatch(float *images, size_t count);
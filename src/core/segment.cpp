@@ -0,0 +1,452 @@
+#include "core/segment.h"
+
+#include "core/network.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+const uint8_t ink_threshold = 200; // 灰度低于此值算作笔画
+const int link_radius = 2;         // 相距不超过此值的笔画像素算作连通，跨过笔画中 1 像素的断口
+const int min_area = 4;            // 面积更小的连通域视为噪点
+const int noise_ratio = 15;        // 面积不到最大数字 1/noise_ratio 的也视为噪点
+const float fragment_gap = 0.4f;   // 矮碎片并入相邻块时允许的最大水平间距（相对行高）
+const float digit_size = 20.0f;      // 训练图片字高（深色笔画）的中位数
+const float max_digit_size = 26.0f;  // 缩放后长边的上限，留出训练图片那样的边缘
+const float fringe_ratio = 0.1f;     // 包围盒外多取的浅色边缘宽度（相对行高）
+const float scale_tolerance = 0.1f;  // 估计的缩放比例与整数比例相差不超过此值时取整数比例
+// 训练图片质心的平均位置（下标坐标，BMP 的行顺序自下而上，自上而下看为 (14, 14)）
+const float digit_center_x = 14.0f;
+const float digit_center_y = 13.0f;
+
+static int findRoot(vector<int32_t> &parent, int32_t i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void unite(vector<int32_t> &parent, int32_t a, int32_t b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a != b)
+        parent[max(a, b)] = min(a, b);
+}
+
+struct Region
+{
+    int x0, y0, x1, y1;
+    long area;
+};
+
+// 两遍扫描的连通域标记：第一遍与已扫描的邻近像素合并，第二遍压缩到根。
+// 每个像素的标签写入 owner（背景 -1），返回各连通域的包围盒
+static vector<Region> labelComponents(const GrayImage &image, vector<int32_t> &owner)
+{
+    const int w = image.width, h = image.height;
+    vector<int32_t> parent;
+    owner.assign((size_t)w * h, -1);
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            if (image.at(x, y) >= ink_threshold)
+                continue;
+            int32_t label = -1;
+            auto join = [&](int nx, int ny)
+            {
+                if (nx < 0 || nx >= w || ny < 0)
+                    return;
+                int32_t other = owner[(size_t)ny * w + nx];
+                if (other < 0)
+                    return;
+                if (label < 0)
+                    label = other;
+                else
+                    unite(parent, label, other);
+            };
+            // 已扫描过的、切比雪夫距离不超过 link_radius 的邻居
+            for (int dy = -link_radius; dy <= 0; dy++)
+            {
+                for (int dx = -link_radius; dx <= (dy < 0 ? link_radius : -1); dx++)
+                    join(x + dx, y + dy);
+            }
+            if (label < 0)
+            {
+                label = parent.size();
+                parent.push_back(label);
+            }
+            owner[(size_t)y * w + x] = label;
+        }
+    }
+
+    vector<int32_t> compact(parent.size(), -1);
+    vector<Region> regions;
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            int32_t &label = owner[(size_t)y * w + x];
+            if (label < 0)
+                continue;
+            int32_t root = findRoot(parent, label);
+            if (compact[root] < 0)
+            {
+                compact[root] = regions.size();
+                regions.push_back({x, y, x, y, 0});
+            }
+            label = compact[root];
+            Region &r = regions[label];
+            r.x0 = min(r.x0, x);
+            r.x1 = max(r.x1, x);
+            r.y0 = min(r.y0, y);
+            r.y1 = max(r.y1, y);
+            r.area++;
+        }
+    }
+    return regions;
+}
+
+// 列投影：连续有墨迹的列组成一段，每段的纵向范围取其中墨迹的上下界
+static vector<Region> splitColumns(const GrayImage &image, vector<int32_t> &owner)
+{
+    const int w = image.width, h = image.height;
+    vector<int> column_ink(w, 0);
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+            column_ink[x] += image.at(x, y) < ink_threshold;
+    }
+
+    vector<Region> regions;
+    vector<int32_t> column_owner(w, -1);
+    for (int x = 0; x < w; x++)
+    {
+        if (column_ink[x] == 0)
+            continue;
+        if (x == 0 || column_ink[x - 1] == 0)
+            regions.push_back({x, h, x, -1, 0});
+        Region &r = regions.back();
+        r.x1 = x;
+        r.area += column_ink[x];
+        column_owner[x] = regions.size() - 1;
+    }
+
+    owner.assign((size_t)w * h, -1);
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            if (column_owner[x] < 0 || image.at(x, y) >= ink_threshold)
+                continue;
+            Region &r = regions[column_owner[x]];
+            r.y0 = min(r.y0, y);
+            r.y1 = max(r.y1, y);
+            owner[(size_t)y * w + x] = column_owner[x];
+        }
+    }
+    return regions;
+}
+
+static int overlap(int a0, int a1, int b0, int b1)
+{
+    return max(0, min(a1, b1) - max(a0, b0) + 1);
+}
+
+void segmentDigits(const GrayImage &image, SegmentMethod method, Segmentation &result)
+{
+    vector<int32_t> &owner = result.owner;
+    vector<Region> regions = method == SegmentMethod::Components ? labelComponents(image, owner)
+                                                                 : splitColumns(image, owner);
+
+    // 1) 去掉噪点
+    long largest = 0;
+    for (const auto &r : regions)
+        largest = max(largest, r.area);
+    vector<int32_t> merged(regions.size());
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        bool noise = regions[i].area < min_area || regions[i].area * noise_ratio < largest;
+        merged[i] = noise ? -1 : (int32_t)i;
+    }
+
+    // 2) 分行：各连通域纵向范围的并集划出文本行（行间有空白），行顺序自上而下，
+    //    即存放顺序中 y 从大到小
+    vector<int> kept;
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        if (merged[i] == (int32_t)i)
+            kept.push_back(i);
+    }
+    sort(kept.begin(), kept.end(), [&](int a, int b)
+         { return regions[a].y1 > regions[b].y1; });
+    vector<int> line_of(regions.size(), -1);
+    int lines = 0, band_y0 = 0; // band_y0：当前行已覆盖的最小 y
+    for (int i : kept)
+    {
+        if (lines == 0 || regions[i].y1 < band_y0)
+        {
+            lines++;
+            band_y0 = regions[i].y0;
+        }
+        line_of[i] = lines - 1;
+        band_y0 = min(band_y0, regions[i].y0);
+    }
+
+    // 3) 合并同一数字的碎片：同一行内水平方向重叠超过较窄者的一半。
+    //    合并后包围盒变大，可能又与别的碎片重叠，所以重复到没有变化为止
+    if (method == SegmentMethod::Components)
+    {
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (size_t a = 0; a < kept.size(); a++)
+            {
+                int i = kept[a];
+                if (merged[i] != i)
+                    continue;
+                for (size_t b = a + 1; b < kept.size(); b++)
+                {
+                    int j = kept[b];
+                    if (merged[j] != j || line_of[j] != line_of[i])
+                        continue;
+                    Region &r = regions[i], &o = regions[j];
+                    int narrower = min(r.x1 - r.x0, o.x1 - o.x0) + 1;
+                    if (2 * overlap(r.x0, r.x1, o.x0, o.x1) < narrower)
+                        continue;
+                    r = {min(r.x0, o.x0), min(r.y0, o.y0), max(r.x1, o.x1), max(r.y1, o.y1), r.area + o.area};
+                    merged[j] = i;
+                    changed = true;
+                }
+            }
+        }
+        kept.erase(remove_if(kept.begin(), kept.end(), [&](int i)
+                             { return merged[i] != i; }),
+                   kept.end());
+
+        // 放大的图片里笔画断口更宽，碎片之间可能没有水平重叠：比本行数字高度中位数的一半
+        // 还矮的碎片并入同一行水平距离最近的块，距离需不超过中位数的 fragment_gap 倍
+        vector<vector<int>> heights(lines);
+        for (int i : kept)
+            heights[line_of[i]].push_back(regions[i].y1 - regions[i].y0 + 1);
+        vector<int> median(lines);
+        for (int l = 0; l < lines; l++)
+        {
+            nth_element(heights[l].begin(), heights[l].begin() + heights[l].size() / 2, heights[l].end());
+            median[l] = heights[l][heights[l].size() / 2];
+        }
+        for (int i : kept)
+        {
+            const Region &r = regions[i];
+            int l = line_of[i];
+            if (merged[i] != i || 2 * (r.y1 - r.y0 + 1) >= median[l])
+                continue;
+            int nearest = -1, nearest_gap = 0;
+            for (int j : kept)
+            {
+                if (j == i || merged[j] != j || line_of[j] != l)
+                    continue;
+                int gap = max(regions[j].x0 - r.x1, r.x0 - regions[j].x1);
+                if (nearest < 0 || gap < nearest_gap)
+                {
+                    nearest = j;
+                    nearest_gap = gap;
+                }
+            }
+            if (nearest < 0 || nearest_gap > median[l] * fragment_gap)
+                continue;
+            Region &o = regions[nearest];
+            o = {min(r.x0, o.x0), min(r.y0, o.y0), max(r.x1, o.x1), max(r.y1, o.y1), r.area + o.area};
+            merged[i] = nearest;
+        }
+        kept.erase(remove_if(kept.begin(), kept.end(), [&](int i)
+                             { return merged[i] != i; }),
+                   kept.end());
+    }
+    sort(kept.begin(), kept.end(), [&](int a, int b)
+         { return line_of[a] != line_of[b] ? line_of[a] < line_of[b] : regions[a].x0 < regions[b].x0; });
+
+    // 4) 输出，并把像素归属改写为最终的数字下标
+    vector<int32_t> final_index(regions.size(), -1);
+    result.digits.clear();
+    for (int i : kept)
+    {
+        final_index[i] = result.digits.size();
+        const Region &r = regions[i];
+        result.digits.push_back({r.x0, r.y0, r.x1, r.y1, line_of[i]});
+    }
+    for (auto &o : owner)
+    {
+        if (o < 0)
+            continue;
+        int32_t root = o;
+        while (root >= 0 && merged[root] != root)
+            root = merged[root];
+        o = root < 0 ? -1 : final_index[root];
+    }
+
+    // 5) 每行字高的中位数，裁剪时据此决定缩放比例
+    vector<vector<int>> line_heights(lines);
+    for (const auto &d : result.digits)
+        line_heights[d.line].push_back(d.y1 - d.y0 + 1);
+    result.line_height.assign(lines, 0);
+    for (int l = 0; l < lines; l++)
+    {
+        vector<int> &h = line_heights[l];
+        if (h.empty())
+            continue;
+        nth_element(h.begin(), h.begin() + h.size() / 2, h.end());
+        result.line_height[l] = h[h.size() / 2];
+    }
+}
+
+void extractDigit(const GrayImage &image, const Segmentation &seg, int index, float *out)
+{
+    const DigitBox &box = seg.digits[index];
+    const int line_height = max(1, seg.line_height[box.line]);
+
+    // 包围盒只含深色笔画，训练图片中笔画外还有一圈浅色的抗锯齿边缘：四周多取 fringe 像素。
+    // 本数字的墨迹拷进四周补一圈 0 的缓冲区，重采样时只需判断一次越界。
+    // 浅色像素未参与切分（owner 为 -1），一律算作本数字的笔画边缘
+    const int fringe = max(1, (int)lround(line_height * fringe_ratio));
+    const int x0 = max(0, box.x0 - fringe), x1 = min(image.width - 1, box.x1 + fringe);
+    const int y0 = max(0, box.y0 - fringe), y1 = min(image.height - 1, box.y1 + fringe);
+    const int bw = x1 - x0 + 1, bh = y1 - y0 + 1;
+    const int stride = bw + 2;
+    vector<float> ink((size_t)stride * (bh + 2), 0.0f);
+    float mass = 0.0f, mx = 0.0f, my = 0.0f;
+    for (int y = 0; y < bh; y++)
+    {
+        size_t k = (size_t)(y0 + y) * image.width + x0;
+        float *row = ink.data() + (size_t)(y + 1) * stride + 1;
+        for (int x = 0; x < bw; x++, k++)
+        {
+            bool mine = seg.owner[k] == index || (seg.owner[k] < 0 && image.pixels[k] >= ink_threshold);
+            float v = mine ? (255 - image.pixels[k]) / 255.0f : 0.0f;
+            row[x] = v;
+            mass += v;
+            mx += v * x;
+            my += v * y;
+        }
+    }
+    // 质心（缓冲区坐标，不含补边）
+    float cx = mass > 0 ? mx / mass : (bw - 1) * 0.5f;
+    float cy = mass > 0 ? my / mass : (bh - 1) * 0.5f;
+
+    // 按行高而不是各自的长边缩放：同一行的数字保持相对大小，窄的 "1" 不会被拉宽。
+    // 训练图片的字高在 12 到 24 像素之间，一行 8 个数字的中位数仍有约 4% 的波动，
+    // 估计的比例与整数比例 k 或 1/k 相差不到 10% 时取整数比例；长边超过 max_digit_size 时再缩小
+    float estimate = digit_size / line_height;
+    float ratio = estimate >= 1.0f ? round(estimate) : 1.0f / round(1.0f / estimate);
+    float scale = fabs(estimate / ratio - 1.0f) <= scale_tolerance ? ratio : estimate;
+    scale = min(scale, max_digit_size / max(box.x1 - box.x0 + 1, box.y1 - box.y0 + 1));
+    // 质心平移到训练图片的质心位置，平移量取在使输出像素边界与原图像素边界对齐的格点上
+    // （间距 min(1, scale)）。整数比例时原图因此逐像素复制或按整块平均，不被插值模糊
+    float spacing = min(1.0f, scale), phase = (scale - 1.0f) * 0.5f;
+    float tx = phase + spacing * round((digit_center_x - cx * scale - phase) / spacing);
+    float ty = phase + spacing * round((digit_center_y - cy * scale - phase) / spacing);
+
+    // 缩小时每个输出像素在 n x n 个子采样点上做双线性插值后取平均，避免混叠。
+    // 插值与平均都可分离：先把 n 个子行纵向插值后平均成一行，再沿横向采样
+    float inv = 1.0f / scale;
+    int n = max(1, (int)ceil(inv));
+    float step = inv / n;
+    vector<float> blended(stride);
+    for (int v = 0; v < 28; v++)
+    {
+        fill(blended.begin(), blended.end(), 0.0f);
+        float sy = (v - ty - 0.5f) * inv + 0.5f * step;
+        for (int j = 0; j < n; j++, sy += step)
+        {
+            if (sy <= -1.0f || sy >= bh)
+                continue;
+            float fy0 = floor(sy);
+            float fy = sy - fy0;
+            const float *r0 = ink.data() + (size_t)((int)fy0 + 1) * stride;
+            const float *r1 = r0 + stride;
+            for (int x = 0; x < stride; x++)
+                blended[x] += r0[x] + fy * (r1[x] - r0[x]);
+        }
+
+        for (int u = 0; u < 28; u++)
+        {
+            float sum = 0.0f;
+            float sx = (u - tx - 0.5f) * inv + 0.5f * step;
+            for (int i = 0; i < n; i++, sx += step)
+            {
+                if (sx <= -1.0f || sx >= bw)
+                    continue;
+                float fx0 = floor(sx);
+                float fx = sx - fx0;
+                int k = (int)fx0 + 1;
+                sum += blended[k] + fx * (blended[k + 1] - blended[k]);
+            }
+            out[v * 28 + u] = 1.0f - min(1.0f, sum / (n * n));
+        }
+    }
+}
+
+void shiftedCopies(const float *digit, float *out)
+{
+    for (int dy = -shift_radius; dy <= shift_radius; dy++)
+    {
+        for (int dx = -shift_radius; dx <= shift_radius; dx++, out += 28 * 28)
+        {
+            for (int y = 0; y < 28; y++)
+            {
+                int sy = y - dy;
+                for (int x = 0; x < 28; x++)
+                {
+                    int sx = x - dx;
+                    out[y * 28 + x] = sy >= 0 && sy < 28 && sx >= 0 && sx < 28 ? digit[sy * 28 + sx] : 1.0f;
+                }
+            }
+        }
+    }
+}
+
+int bestShift(const float *scores, int candidates)
+{
+    int best = 0;
+    float best_score = -1.0f;
+    for (int c = 0; c < candidates; c++)
+    {
+        float top = *max_element(scores + c * output_size, scores + (c + 1) * output_size);
+        if (top > best_score)
+        {
+            best_score = top;
+            best = c;
+        }
+    }
+    return best;
+}
+
+GrayImage composeStrip(const vector<const float *> &digits, int scale, int gap)
+{
+    const int margin = 8, cell = 28 * scale;
+    const int count = digits.size();
+    GrayImage image;
+    image.width = 2 * margin + count * cell + max(0, count - 1) * gap;
+    image.height = 2 * margin + cell;
+    image.pixels.assign((size_t)image.width * image.height, 255);
+    for (int d = 0; d < count; d++)
+    {
+        int x0 = margin + d * (cell + gap);
+        for (int y = 0; y < cell; y++)
+        {
+            for (int x = 0; x < cell; x++)
+            {
+                uint8_t v = (uint8_t)lround(255.0f * min(1.0f, max(0.0f, digits[d][(y / scale) * 28 + x / scale])));
+                uint8_t &p = image.pixels[(size_t)(margin + y) * image.width + x0 + x];
+                p = min(p, v);
+            }
+        }
+    }
+    return image;
+}
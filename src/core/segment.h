@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/bmp.h"
+
+// 大图中的多位数字切分：白底黑字的灰度图 -> 按阅读顺序排列的候选数字。
+// 坐标与 GrayImage 相同（行为自下而上的存放顺序），区间均为闭区间
+
+enum class SegmentMethod
+{
+    Components, // 连通域（容忍细小断口），同一行中笔画断开的碎片合并回数字；支持多行
+    Columns,    // 按列投影在空白列处切开；只适用于单行、数字之间有空隙的输入
+};
+
+struct DigitBox
+{
+    int x0, y0, x1, y1;
+    int line; // 所在文本行，自上而下从 0 开始
+};
+
+struct Segmentation
+{
+    std::vector<DigitBox> digits; // 按行、行内从左到右排序
+    std::vector<int32_t> owner;   // 每个像素所属的数字下标，背景与噪点为 -1
+    std::vector<int> line_height; // 每行数字高度的中位数
+};
+
+void segmentDigits(const GrayImage &image, SegmentMethod method, Segmentation &result);
+
+// 把第 index 个数字裁出并缩放为网络输入（28x28，0-1，白底），与训练图片的约定一致：
+// 本行的字高中位数缩放到训练图片的字高（20 像素），质心按整数像素平移到训练图片的质心位置。
+// 只取属于该数字的墨迹，相邻数字伸进包围盒的部分被忽略
+void extractDigit(const GrayImage &image, const Segmentation &seg, int index, float *out);
+
+// 训练图片自身的摆放有 1~2 像素的抖动（质心与包围盒都不固定），裁剪无法还原每张原图的位置，
+// 而全连接网络对平移很敏感（训练集整体平移 1 像素，准确率降到 40%~75%）。
+// 识别时把裁好的数字在 [-shift_radius, shift_radius] 内逐像素平移得到 shift_count 个候选，
+// 一起前向传播后取最大输出值最高的一个（见 bestShift）
+const int shift_radius = 2;
+const int shift_count = (2 * shift_radius + 1) * (2 * shift_radius + 1);
+
+// digit 的 shift_count 个平移副本依次写入 out（每个 28x28），移出的部分补白
+void shiftedCopies(const float *digit, float *out);
+
+// scores 为 candidates 个候选的网络输出（每个 10 个值），返回最大输出值最高的候选
+int bestShift(const float *scores, int candidates);
+
+// 把若干 28x28 网络输入（0-1，白底，与 BMP 相同的行顺序）最近邻放大 scale 倍后横排成一行，
+// 相邻数字的 28x28 格子之间留 gap 像素，四周留白。用于从训练集合成多位数字的测试图片
+GrayImage composeStrip(const std::vector<const float *> &digits, int scale, int gap);
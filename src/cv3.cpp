@@ -5,100 +5,258 @@
 #include <cmath>
 #include <string>
 #include <random>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <fcntl.h>
+#ifdef DIGITS_NUMA
+#include <numa.h>
+#endif
+
+#include "core/args.h"
+#include "core/dataset.h"
+#include "core/half.h"
+#include "core/metrics.h"
+#include "core/model_io.h"
+#include "core/network.h"
 using namespace std;
 
-const int input_size = 784;
-const int hidden_size = 256;
-const int output_size = 10;
-const float learning_rate = 0.01f;
+int hidden_size = default_hidden_size; // 可用 --hidden 修改，例如训练蒸馏用的小型学生网络
 
-// BMP文件头结构
-#pragma pack(push, 1)
-struct BMPHeader
+// 混合精度训练使用的 16 位权重工作副本；fp32 主权重仍保存在 Layer 中。
+// SGD 的更新量远小于 bf16 的精度，只能累加在 fp32 主权重上；工作副本每 --half-refresh
+// 个样本整体刷新一次，而不是每步逐行重新转换
+struct HalfWeights
 {
-    char bfType[2];
-    uint32_t bfSize;
-    uint16_t bfReserved1;
-    uint16_t bfReserved2;
-    uint32_t bfOffBits;
+    vector<uint16_t> inputToHidden;
+    vector<uint16_t> hiddenToOutput;
 };
 
-struct BMPInfoHeader
+void refreshHalfWeights(const Layer &inputToHidden, const Layer &hiddenToOutput,
+                        HalfWeights &half, HalfFormat format)
 {
-    uint32_t biSize;
-    int32_t biWidth;
-    int32_t biHeight;
-    uint16_t biPlanes;
-    uint16_t biBitCount;
-    uint32_t biCompression;
-    uint32_t biSizeImage;
-    int32_t biXPelsPerMeter;
-    int32_t biYPelsPerMeter;
-    uint32_t biClrUsed;
-    uint32_t biClrImportant;
-};
-#pragma pack(pop)
+    half.inputToHidden.resize(inputToHidden.weights.size());
+    half.hiddenToOutput.resize(hiddenToOutput.weights.size());
+    convertToHalf(inputToHidden.weights.data(), half.inputToHidden.data(), half.inputToHidden.size(), format);
+    convertToHalf(hiddenToOutput.weights.data(), half.hiddenToOutput.data(), half.hiddenToOutput.size(), format);
+}
 
-// 读取BMP文件
-bool readBMP(const string &filename, vector<uint8_t> &pixelData)
+// 混合精度点积的并行累加路数：input_size 是它的整数倍，各路独立累加可以向量化
+const int mixed_lanes = 8;
+
+// x 与一行 16 位权重的点积：按 mixed_lanes 一段展开为 fp32（bf16 为移位，fp16 在支持 F16C 时 8 个一次），fp32 累加
+template <HalfFormat F>
+static inline float dotHalf(const float *x, const uint16_t *row, int n)
 {
-    BMPHeader bmpHeader;
-    BMPInfoHeader bmpInfoHeader;
+    float acc[mixed_lanes] = {};
+    int i = 0;
+    for (; i + mixed_lanes <= n; i += mixed_lanes)
+    {
+        float w[mixed_lanes];
+        if constexpr (F == HalfFormat::BF16)
+        {
+            for (int k = 0; k < mixed_lanes; k++)
+                w[k] = bf16ToFloat(row[i + k]); // 移位即可，编译器可内联并向量化
+        }
+        else
+        {
+            convertToFloat(row + i, w, mixed_lanes, F);
+        }
+        for (int k = 0; k < mixed_lanes; k++)
+            acc[k] += x[i + k] * w[k];
+    }
+    float sum = 0.0f;
+    for (; i < n; i++)
+        sum += x[i] * halfToFloat<F>(row[i]);
+    for (int k = 0; k < mixed_lanes; k++)
+        sum += acc[k];
+    return sum;
+}
+
+// 前向传播：读取 16 位的输入与权重，在 fp32 中累加。输入只展开一次，供所有隐藏单元复用
+template <HalfFormat F>
+ForwardResult forwardPropagationMixed(const vector<uint16_t> &input,
+                                      const HalfWeights &half,
+                                      const Layer &inputToHidden,
+                                      const Layer &hiddenToOutput)
+{
+    ForwardResult result;
+    result.hidden.resize(hidden_size);
+    result.hidden_z.resize(hidden_size);
+    result.output.resize(output_size);
+    result.output_z.resize(output_size);
 
-    ifstream inputFile(filename, ios::binary);
-    if (!inputFile)
+    float x[input_size];
+    convertToFloat(input.data(), x, input_size, F);
+    for (int h = 0; h < hidden_size; h++)
     {
-        cerr << "Error: Could not open file " << filename << endl;
-        return false;
+        float sum = dotHalf<F>(x, half.inputToHidden.data() + (size_t)h * input_size, input_size);
+        result.hidden_z[h] = sum + inputToHidden.biases[h];
+        result.hidden[h] = sigmoid(result.hidden_z[h]);
     }
 
-    inputFile.read(reinterpret_cast<char *>(&bmpHeader), sizeof(bmpHeader));
-    if (bmpHeader.bfType[0] != 'B' || bmpHeader.bfType[1] != 'M')
+    for (int o = 0; o < output_size; o++)
     {
-        cerr << "Error: Not a valid BMP file." << endl;
-        return false;
+        float sum = dotHalf<F>(result.hidden.data(), half.hiddenToOutput.data() + (size_t)o * hidden_size, hidden_size);
+        result.output_z[o] = sum + hiddenToOutput.biases[o];
+        result.output[o] = sigmoid(result.output_z[o]);
     }
 
-    inputFile.read(reinterpret_cast<char *>(&bmpInfoHeader), sizeof(bmpInfoHeader));
+    return result;
+}
 
-    inputFile.seekg(bmpHeader.bfOffBits, ios::beg);
-    int rowSize = ((bmpInfoHeader.biWidth * bmpInfoHeader.biBitCount + 31) / 32) * 4;
-    int imageSize = rowSize * abs(bmpInfoHeader.biHeight);
-    pixelData.resize(imageSize);
-    inputFile.read(reinterpret_cast<char *>(pixelData.data()), imageSize);
+// 反向传播：梯度更新只写入 fp32 主权重，16 位工作副本由调用方按间隔刷新
+template <HalfFormat F>
+void backwardPropagationMixed(const vector<uint16_t> &input,
+                              const ForwardResult &forward_result,
+                              const vector<float> &output_delta,
+                              Layer &inputToHidden,
+                              Layer &hiddenToOutput)
+{
+    vector<float> hidden_delta(hidden_size);
+    for (int h = 0; h < hidden_size; h++)
+    {
+        float error = 0.0f;
+        for (int o = 0; o < output_size; o++)
+        {
+            error += output_delta[o] * hiddenToOutput.weights[h + o * hidden_size];
+        }
+        hidden_delta[h] = error * sigmoid_derivative(forward_result.hidden_z[h]);
+    }
 
-    inputFile.close();
-    return true;
+    for (int o = 0; o < output_size; o++)
+    {
+        float *master = hiddenToOutput.weights.data() + o * hidden_size;
+        for (int h = 0; h < hidden_size; h++)
+        {
+            master[h] -= learning_rate * output_delta[o] * forward_result.hidden[h];
+        }
+        hiddenToOutput.biases[o] -= learning_rate * output_delta[o];
+    }
+
+    vector<float> x(input_size);
+    convertToFloat(input.data(), x.data(), input_size, F);
+    for (int h = 0; h < hidden_size; h++)
+    {
+        float *master = inputToHidden.weights.data() + h * input_size;
+        for (int i = 0; i < input_size; i++)
+        {
+            master[i] -= learning_rate * hidden_delta[h] * x[i];
+        }
+        inputToHidden.biases[h] -= learning_rate * hidden_delta[h];
+    }
 }
 
-struct Layer
+// 分块权重布局：隐藏单元按 panel_width 个一组，组内按输入像素交错存放，
+// 即 weights[(h / P) * input_size * P + i * P + h % P]。前向累加与反向更新都是
+// 沿 i 顺序扫描、在组内做 P 路向量运算，两者访问顺序一致
+const int panel_width = 16; // 16 个 float 正好一条 64 字节缓存行
+
+// 64 字节对齐的浮点缓冲区；定义 DIGITS_NUMA 时从调用线程所在的 NUMA 节点分配
+class AlignedBuffer
 {
-    vector<float> weights;
-    vector<float> biases;
+public:
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(size_t count) : size_(count)
+    {
+        bytes_ = (count * sizeof(float) + 63) / 64 * 64;
+#ifdef DIGITS_NUMA
+        if (numa_available() >= 0)
+            data_ = static_cast<float *>(numa_alloc_local(bytes_));
+        else
+#endif
+            data_ = static_cast<float *>(aligned_alloc(64, bytes_));
+        if (!data_)
+            throw bad_alloc();
+        // 首次写入：由将要使用这块内存的线程触碰页面，页面落在本地节点
+        memset(data_, 0, bytes_);
+    }
+    AlignedBuffer(const AlignedBuffer &) = delete;
+    AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+    AlignedBuffer(AlignedBuffer &&other) noexcept { swap(other); }
+    AlignedBuffer &operator=(AlignedBuffer &&other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+    ~AlignedBuffer() { release(); }
+
+    float *data() { return data_; }
+    const float *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void swap(AlignedBuffer &other)
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(bytes_, other.bytes_);
+    }
+    void release()
+    {
+        if (!data_)
+            return;
+#ifdef DIGITS_NUMA
+        if (numa_available() >= 0)
+        {
+            numa_free(data_, bytes_);
+            return;
+        }
+#endif
+        free(data_);
+    }
+
+    float *data_ = nullptr;
+    size_t size_ = 0;
+    size_t bytes_ = 0;
 };
 
-float sigmoid(float x)
+// 分块存放的 inputToHidden 权重；偏置仍使用 Layer::biases
+struct BlockedWeights
 {
-    return 1.0f / (1.0f + exp(-x));
-}
+    AlignedBuffer weights;
+    int panels = 0;
+};
 
-float sigmoid_derivative(float x)
+void packBlocked(const Layer &layer, BlockedWeights &blocked)
 {
-    float sig = sigmoid(x);
-    return sig * (1.0f - sig);
+    blocked.panels = (hidden_size + panel_width - 1) / panel_width;
+    blocked.weights = AlignedBuffer((size_t)blocked.panels * input_size * panel_width);
+    float *dst = blocked.weights.data();
+    for (int h = 0; h < hidden_size; h++)
+    {
+        float *panel = dst + (size_t)(h / panel_width) * input_size * panel_width + h % panel_width;
+        for (int i = 0; i < input_size; i++)
+            panel[i * panel_width] = layer.weights[i + h * input_size];
+    }
 }
 
-struct ForwardResult
+// 还原为 saveModel 使用的行优先格式
+void unpackBlocked(const BlockedWeights &blocked, vector<float> &weights)
 {
-    vector<float> hidden;
-    vector<float> output;
-    vector<float> hidden_z;
-    vector<float> output_z;
-};
+    weights.resize(input_size * hidden_size);
+    const float *src = blocked.weights.data();
+    for (int h = 0; h < hidden_size; h++)
+    {
+        const float *panel = src + (size_t)(h / panel_width) * input_size * panel_width + h % panel_width;
+        for (int i = 0; i < input_size; i++)
+            weights[i + h * input_size] = panel[i * panel_width];
+    }
+}
 
-ForwardResult forwardPropagation(const vector<float> &input,
-                                 const Layer &inputToHidden,
-                                 const Layer &hiddenToOutput)
+ForwardResult forwardPropagationBlocked(const vector<float> &input,
+                                        const BlockedWeights &blocked,
+                                        const Layer &inputToHidden,
+                                        const Layer &hiddenToOutput)
 {
     ForwardResult result;
     result.hidden.resize(hidden_size);
@@ -106,15 +264,22 @@ ForwardResult forwardPropagation(const vector<float> &input,
     result.output.resize(output_size);
     result.output_z.resize(output_size);
 
-    for (int h = 0; h < hidden_size; h++)
+    for (int p = 0; p < blocked.panels; p++)
     {
-        float sum = 0.0f;
+        const float *__restrict panel = blocked.weights.data() + (size_t)p * input_size * panel_width;
+        alignas(64) float sum[panel_width] = {};
         for (int i = 0; i < input_size; i++)
         {
-            sum += input[i] * inputToHidden.weights[i + h * input_size];
+            float x = input[i];
+            for (int k = 0; k < panel_width; k++)
+                sum[k] += x * panel[i * panel_width + k];
+        }
+        for (int k = 0; k < panel_width && p * panel_width + k < hidden_size; k++)
+        {
+            int h = p * panel_width + k;
+            result.hidden_z[h] = sum[k] + inputToHidden.biases[h];
+            result.hidden[h] = sigmoid(result.hidden_z[h]);
         }
-        result.hidden_z[h] = sum + inputToHidden.biases[h];
-        result.hidden[h] = sigmoid(result.hidden_z[h]);
     }
 
     for (int o = 0; o < output_size; o++)
@@ -131,20 +296,15 @@ ForwardResult forwardPropagation(const vector<float> &input,
     return result;
 }
 
-void backwardPropagation(const vector<float> &input,
-                         const ForwardResult &forward_result,
-                         const vector<float> &target,
-                         Layer &inputToHidden,
-                         Layer &hiddenToOutput)
+void backwardPropagationBlocked(const vector<float> &input,
+                                const ForwardResult &forward_result,
+                                const vector<float> &output_delta,
+                                BlockedWeights &blocked,
+                                Layer &inputToHidden,
+                                Layer &hiddenToOutput)
 {
-    vector<float> output_delta(output_size);
-    for (int o = 0; o < output_size; o++)
-    {
-        float error = forward_result.output[o] - target[o];
-        output_delta[o] = error * sigmoid_derivative(forward_result.output_z[o]);
-    }
-
-    vector<float> hidden_delta(hidden_size);
+    // 填充到整组，补齐的单元 delta 为 0，不会改变补齐位置的权重
+    vector<float> hidden_delta(blocked.panels * panel_width, 0.0f);
     for (int h = 0; h < hidden_size; h++)
     {
         float error = 0.0f;
@@ -165,89 +325,586 @@ void backwardPropagation(const vector<float> &input,
         hiddenToOutput.biases[o] -= learning_rate * output_delta[o];
     }
 
-    for (int h = 0; h < hidden_size; h++)
+    for (int p = 0; p < blocked.panels; p++)
     {
+        float *__restrict panel = blocked.weights.data() + (size_t)p * input_size * panel_width;
+        const float *delta = hidden_delta.data() + p * panel_width;
         for (int i = 0; i < input_size; i++)
         {
-            float grad = hidden_delta[h] * input[i];
-            inputToHidden.weights[i + h * input_size] -= learning_rate * grad;
+            float x = input[i];
+            for (int k = 0; k < panel_width; k++)
+                panel[i * panel_width + k] -= learning_rate * (delta[k] * x);
         }
+    }
+    for (int h = 0; h < hidden_size; h++)
         inputToHidden.biases[h] -= learning_rate * hidden_delta[h];
+}
+
+// 训练检查点：包含恢复训练所需的全部状态。按时间间隔写入时可能落在 epoch 中途，
+// 此时 order 是本 epoch 已打乱的顺序，从 position 处继续即可。
+// 混合精度时 16 位工作副本是上次刷新时的主权重，与主权重不同，所以连同刷新计数一起保存
+struct Checkpoint
+{
+    uint32_t epoch = 0;    // 已完成的 epoch 数
+    uint32_t position = 0; // 当前 epoch 内已训练的样本数
+    float learning_rate = 0.0f;
+    uint32_t seed = 0;          // 初始化权重与打乱顺序所用的种子
+    uint32_t precision = 0;     // 0 为 fp32，否则为 HalfFormat
+    uint32_t preprocess = 0;    // 训练数据是否经过 preprocessDigit
+    uint32_t shuffle = 0;       // 每个 epoch 是否打乱顺序
+    uint32_t half_refresh = 0;  // 混合精度时 16 位副本的刷新间隔
+    uint32_t since_refresh = 0; // 上次刷新以来训练的样本数
+    float distill_alpha = 0.0f;
+    float temperature = 0.0f;
+    double holdout = 0.0;       // 留出的比例，决定训练集由哪些样本组成
+    string data_root;
+    string teacher_path;        // 非空时为蒸馏训练
+    string rng_state;           // mt19937 的文本状态
+    vector<uint32_t> order;     // 样本遍历顺序
+    Layer inputToHidden;
+    Layer hiddenToOutput;
+    HalfWeights half; // fp32 训练时为空
+};
+
+const char checkpoint_magic[4] = {'D', 'G', 'C', 'K'};
+const uint32_t checkpoint_version = 4;
+
+static bool writeBlock(FILE *f, const void *data, size_t bytes)
+{
+    return fwrite(data, 1, bytes, f) == bytes;
+}
+
+static bool writeString(FILE *f, const string &s)
+{
+    uint32_t size = s.size();
+    return writeBlock(f, &size, sizeof(size)) && writeBlock(f, s.data(), size);
+}
+
+static bool writeLayer(FILE *f, const Layer &layer)
+{
+    uint32_t weights_size = layer.weights.size();
+    uint32_t biases_size = layer.biases.size();
+    return writeBlock(f, &weights_size, sizeof(weights_size)) &&
+           writeBlock(f, &biases_size, sizeof(biases_size)) &&
+           writeBlock(f, layer.weights.data(), weights_size * sizeof(float)) &&
+           writeBlock(f, layer.biases.data(), biases_size * sizeof(float));
+}
+
+static bool writeHalf(FILE *f, const vector<uint16_t> &weights)
+{
+    uint32_t size = weights.size();
+    return writeBlock(f, &size, sizeof(size)) && writeBlock(f, weights.data(), size * sizeof(uint16_t));
+}
+
+// rename 之后还要 fsync 所在目录，否则掉电后目录项可能仍指向旧文件
+static bool syncParentDirectory(const string &filename)
+{
+    size_t slash = filename.rfind('/');
+    string dir = slash == string::npos ? "." : slash == 0 ? "/" : filename.substr(0, slash);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// 先写临时文件并 fsync，再 rename 覆盖，保证磁盘上始终是完整的检查点
+bool saveCheckpoint(const Checkpoint &ck, const string &filename)
+{
+    string tmp = filename + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+        cerr << "Error: Could not open file " << tmp << " for writing." << endl;
+        return false;
+    }
+
+    uint32_t order_size = ck.order.size();
+    bool ok = writeBlock(f, checkpoint_magic, sizeof(checkpoint_magic)) &&
+              writeBlock(f, &checkpoint_version, sizeof(checkpoint_version)) &&
+              writeBlock(f, &ck.epoch, sizeof(ck.epoch)) &&
+              writeBlock(f, &ck.position, sizeof(ck.position)) &&
+              writeBlock(f, &ck.learning_rate, sizeof(ck.learning_rate)) &&
+              writeBlock(f, &ck.seed, sizeof(ck.seed)) &&
+              writeBlock(f, &ck.precision, sizeof(ck.precision)) &&
+              writeBlock(f, &ck.preprocess, sizeof(ck.preprocess)) &&
+              writeBlock(f, &ck.shuffle, sizeof(ck.shuffle)) &&
+              writeBlock(f, &ck.half_refresh, sizeof(ck.half_refresh)) &&
+              writeBlock(f, &ck.since_refresh, sizeof(ck.since_refresh)) &&
+              writeBlock(f, &ck.distill_alpha, sizeof(ck.distill_alpha)) &&
+              writeBlock(f, &ck.temperature, sizeof(ck.temperature)) &&
+              writeBlock(f, &ck.holdout, sizeof(ck.holdout)) &&
+              writeString(f, ck.data_root) &&
+              writeString(f, ck.teacher_path) &&
+              writeString(f, ck.rng_state) &&
+              writeBlock(f, &order_size, sizeof(order_size)) &&
+              writeBlock(f, ck.order.data(), order_size * sizeof(uint32_t)) &&
+              writeLayer(f, ck.inputToHidden) &&
+              writeLayer(f, ck.hiddenToOutput) &&
+              writeHalf(f, ck.half.inputToHidden) &&
+              writeHalf(f, ck.half.hiddenToOutput);
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        cerr << "Error: Failed to write checkpoint " << filename << endl;
+        remove(tmp.c_str());
+        return false;
     }
+    if (!syncParentDirectory(filename))
+    {
+        cerr << "Error: Failed to sync the directory of checkpoint " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// 字符串字段的长度上限，防止损坏的文件触发巨大的分配
+const uint32_t checkpoint_max_string = 1 << 16;
+
+static bool readString(ifstream &inFile, string &s)
+{
+    uint32_t size = 0;
+    inFile.read(reinterpret_cast<char *>(&size), sizeof(size));
+    if (!inFile || size > checkpoint_max_string)
+        return false;
+    s.resize(size);
+    inFile.read(&s[0], size);
+    return (bool)inFile;
 }
 
-vector<float> getTarget(int label)
+// 长度必须恰好为 expected，不按文件中的长度分配
+static bool readHalf(ifstream &inFile, vector<uint16_t> &weights, size_t expected)
 {
-    vector<float> target(output_size, 0.0f);
-    target[label] = 1.0f;
-    return target;
+    uint32_t size = 0;
+    inFile.read(reinterpret_cast<char *>(&size), sizeof(size));
+    if (!inFile || size != expected)
+        return false;
+    weights.resize(size);
+    inFile.read(reinterpret_cast<char *>(weights.data()), size * sizeof(uint16_t));
+    return (bool)inFile;
 }
 
-// 保存模型到文件
-void saveModel(const Layer &inputToHidden, const Layer &hiddenToOutput, const string &filename)
+bool loadCheckpoint(Checkpoint &ck, const string &filename)
 {
-    ofstream outFile(filename, ios::binary);
-    if (!outFile)
-    {
-        cerr << "Error: Could not open file " << filename << " for writing." << endl;
-        return;
-    }
-
-    // 保存输入到隐藏层的权重和偏置
-    uint32_t weights_size = inputToHidden.weights.size();
-    uint32_t biases_size = inputToHidden.biases.size();
-    outFile.write(reinterpret_cast<const char *>(&weights_size), sizeof(weights_size));
-    outFile.write(reinterpret_cast<const char *>(&biases_size), sizeof(biases_size));
-    outFile.write(reinterpret_cast<const char *>(inputToHidden.weights.data()), weights_size * sizeof(float));
-    outFile.write(reinterpret_cast<const char *>(inputToHidden.biases.data()), biases_size * sizeof(float));
-
-    // 保存隐藏到输出层的权重和偏置
-    weights_size = hiddenToOutput.weights.size();
-    biases_size = hiddenToOutput.biases.size();
-    outFile.write(reinterpret_cast<const char *>(&weights_size), sizeof(weights_size));
-    outFile.write(reinterpret_cast<const char *>(&biases_size), sizeof(biases_size));
-    outFile.write(reinterpret_cast<const char *>(hiddenToOutput.weights.data()), weights_size * sizeof(float));
-    outFile.write(reinterpret_cast<const char *>(hiddenToOutput.biases.data()), biases_size * sizeof(float));
-
-    outFile.close();
-    cout << "Model saved to " << filename << endl;
+    ifstream inFile(filename, ios::binary);
+    if (!inFile)
+    {
+        cerr << "Error: Could not open file " << filename << " for reading." << endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0, order_size = 0;
+    inFile.read(magic, sizeof(magic));
+    inFile.read(reinterpret_cast<char *>(&version), sizeof(version));
+    if (!inFile || memcmp(magic, checkpoint_magic, sizeof(magic)) != 0 || version != checkpoint_version)
+    {
+        cerr << "Error: " << filename << " is not a valid checkpoint (expected version " << checkpoint_version << ")." << endl;
+        return false;
+    }
+    inFile.read(reinterpret_cast<char *>(&ck.epoch), sizeof(ck.epoch));
+    inFile.read(reinterpret_cast<char *>(&ck.position), sizeof(ck.position));
+    inFile.read(reinterpret_cast<char *>(&ck.learning_rate), sizeof(ck.learning_rate));
+    inFile.read(reinterpret_cast<char *>(&ck.seed), sizeof(ck.seed));
+    inFile.read(reinterpret_cast<char *>(&ck.precision), sizeof(ck.precision));
+    inFile.read(reinterpret_cast<char *>(&ck.preprocess), sizeof(ck.preprocess));
+    inFile.read(reinterpret_cast<char *>(&ck.shuffle), sizeof(ck.shuffle));
+    inFile.read(reinterpret_cast<char *>(&ck.half_refresh), sizeof(ck.half_refresh));
+    inFile.read(reinterpret_cast<char *>(&ck.since_refresh), sizeof(ck.since_refresh));
+    inFile.read(reinterpret_cast<char *>(&ck.distill_alpha), sizeof(ck.distill_alpha));
+    inFile.read(reinterpret_cast<char *>(&ck.temperature), sizeof(ck.temperature));
+    inFile.read(reinterpret_cast<char *>(&ck.holdout), sizeof(ck.holdout));
+    bool ok = inFile && readString(inFile, ck.data_root) && readString(inFile, ck.teacher_path) &&
+              readString(inFile, ck.rng_state);
+    if (ok)
+        inFile.read(reinterpret_cast<char *>(&order_size), sizeof(order_size));
+    // 顺序表的长度就是样本数，最多 output_size * 500 张之外再留足余量
+    ok = ok && inFile && order_size <= (1u << 24);
+    if (ok)
+    {
+        ck.order.resize(order_size);
+        inFile.read(reinterpret_cast<char *>(ck.order.data()), order_size * sizeof(uint32_t));
+    }
+    // 16 位工作副本：混合精度时与对应层的权重数相同，fp32 时为空
+    if (!ok || !inFile || !readLayer(inFile, ck.inputToHidden, input_size) ||
+        !readLayer(inFile, ck.hiddenToOutput, ck.inputToHidden.biases.size()) ||
+        !readHalf(inFile, ck.half.inputToHidden, ck.precision ? ck.inputToHidden.weights.size() : 0) ||
+        !readHalf(inFile, ck.half.hiddenToOutput, ck.precision ? ck.hiddenToOutput.weights.size() : 0))
+    {
+        cerr << "Error: Checkpoint " << filename << " is truncated or corrupt." << endl;
+        return false;
+    }
+    return true;
 }
-// 用于存放一条训练样本
-struct Sample
+
+// 后台写检查点：训练线程只负责拷贝一份快照，磁盘写入在常驻的写线程完成，submit 从不等待磁盘。
+// 双缓冲：一份快照正在写入时，新快照放进待写槽位（覆盖尚未开始写的旧快照），当前写完后接着写
+class AsyncCheckpointer
 {
-    vector<float> input;
-    int label;
+public:
+    explicit AsyncCheckpointer(string filename) : filename_(move(filename)) {}
+    ~AsyncCheckpointer() { finish(); }
+
+    void submit(Checkpoint snapshot)
+    {
+        {
+            lock_guard<mutex> lock(mutex_);
+            if (pending_)
+                superseded_.add();
+            pending_ = move(snapshot);
+            queue_depth_.set(writing_ + 1);
+        }
+        wake_.notify_one();
+    }
+
+    // 写完所有已提交的快照后返回
+    void finish()
+    {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+private:
+    void run()
+    {
+        unique_lock<mutex> lock(mutex_);
+        while (true)
+        {
+            wake_.wait(lock, [this]
+                       { return stopping_ || pending_; });
+            if (!pending_)
+                return;
+            Checkpoint ck = move(*pending_);
+            pending_.reset();
+            writing_ = true;
+            lock.unlock();
+
+            auto start = chrono::steady_clock::now();
+            if (saveCheckpoint(ck, filename_))
+                cout << "Checkpoint saved to " << filename_ << " (epoch " << ck.epoch << ", sample " << ck.position << ")\n";
+            write_seconds_.observe(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+            lock.lock();
+            writing_ = false;
+            queue_depth_.set(pending_ ? 1 : 0);
+        }
+    }
+
+    string filename_;
+    mutex mutex_;
+    condition_variable wake_;
+    optional<Checkpoint> pending_;
+    bool writing_ = false;
+    bool stopping_ = false;
+    Gauge &queue_depth_ = metrics().gauge("digits_checkpoint_queue_depth", "Checkpoints being written or waiting to be written");
+    Counter &superseded_ = metrics().counter("digits_checkpoint_superseded_total", "Snapshots replaced by a newer one before being written");
+    Histogram &write_seconds_ = metrics().histogram("digits_checkpoint_write_seconds", "Time to write and fsync a checkpoint");
+    thread worker_{[this]
+                   { run(); }}; // 最后初始化，保证 run 用到的成员都已构造
 };
 
-int main()
+// 一个 epoch 的训练统计：损失（均方误差）与准确率取自每个样本更新前的前向结果
+struct EpochStats
 {
+    double loss = 0.0;
+    size_t correct = 0;
+    size_t samples = 0;
+
+    void add(const vector<float> &output, const vector<float> &target, int label)
+    {
+        float sum = 0.0f;
+        for (int o = 0; o < output_size; o++)
+            sum += (output[o] - target[o]) * (output[o] - target[o]);
+        loss += 0.5f * sum;
+        correct += getPredictedDigit(output) == label;
+        samples++;
+    }
+};
+
+// 蒸馏的输出层误差。温度同时作用于教师与学生（Hinton 等人的做法）：
+//   L = (1 - alpha) * MSE(sigmoid(z), y) + alpha * T^2 * MSE(sigmoid(z / T), sigmoid(z_teacher / T))
+// 软损失对 z 的梯度带一个 1/T，乘以 T^2 后为 T 倍，改变温度时软硬两部分的梯度量级保持相当
+vector<float> distillDelta(const ForwardResult &forward_result, const vector<float> &hard,
+                           const vector<float> &soft, float alpha, float temperature)
+{
+    vector<float> output_delta(output_size);
+    for (int o = 0; o < output_size; o++)
+    {
+        float z = forward_result.output_z[o];
+        float hard_delta = (forward_result.output[o] - hard[o]) * sigmoid_derivative(z);
+        float s = sigmoid(z / temperature);
+        float soft_delta = temperature * (s - soft[o]) * s * (1.0f - s);
+        output_delta[o] = alpha * soft_delta + (1.0f - alpha) * hard_delta;
+    }
+    return output_delta;
+}
+
+// 蒸馏报告中一个网络的评估结果
+struct ModelReport
+{
+    double accuracy = 0.0;
+    double latency_us = 0.0;
+    size_t parameters = 0;
+};
+
+ModelReport evaluateModel(const vector<vector<float>> &inputs, const vector<int> &labels,
+                          const Layer &inputToHidden, const Layer &hiddenToOutput)
+{
+    ModelReport report;
+    report.parameters = weightCount(inputToHidden) + inputToHidden.biases.size() +
+                        weightCount(hiddenToOutput) + hiddenToOutput.biases.size();
+    // 先不计时跑一遍，教师与学生都在热缓存下比较
+    for (const auto &x : inputs)
+        forwardLogits(x, inputToHidden, hiddenToOutput);
+    int correct = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t n = 0; n < inputs.size(); n++)
+    {
+        vector<float> logits = forwardLogits(inputs[n], inputToHidden, hiddenToOutput);
+        if (max_element(logits.begin(), logits.end()) - logits.begin() == labels[n])
+            correct++;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    report.accuracy = (double)correct / inputs.size();
+    report.latency_us = seconds * 1e6 / inputs.size();
+    return report;
+}
+
+void usage(const char *prog)
+{
+    cerr << "Usage: " << prog << " [--epochs 500] [--seed N] [--shuffle] [--checkpoint checkpoint.bin]\n"
+         << "       [--checkpoint-every N] [--checkpoint-secs T] [--resume]\n"
+         << "       [--precision fp32|bf16|fp16] [--half-refresh 32] [--export-half model_half.bin]\n"
+         << "       [--layout blocked|rowmajor] [--hidden 256] [--out model.bin]\n"
+         << "       [--data ../public/train_bmp] [--preprocess]\n"
+         << "       [--metrics FILE|unix:SOCKET] [--metrics-format prometheus|json] [--metrics-interval 10]\n"
+         << "       [--distill teacher.bin] [--alpha 0.5] [--temperature 2] [--holdout 0.1]\n";
+}
+
+int main(int argc, char **argv)
+{
+    int epochs = 500;
+    bool shuffle_data = false;
+    bool preprocess = false; // 去倾斜、居中并归一化大小；记录在模型文件头中，read / eval / prune 据此自动预处理
+    string checkpoint_path = "checkpoint.bin";
+    int half_refresh = 32;       // 混合精度：每 N 个样本刷新一次 16 位权重副本
+    int checkpoint_every = 0;    // 每 N 个 epoch 写一次，0 表示关闭
+    double checkpoint_secs = 0;  // 距上次写入超过 T 秒则写一次，0 表示关闭
+    bool resume = false;
+    unsigned seed = 0; // 0 表示使用 random_device
+    bool seed_given = false;
+    bool mixed = false;
+    HalfFormat half_format = HalfFormat::BF16;
+    string export_half_path;
+    bool blocked_layout = true;
+    string out_path = "model.bin";
+    string data_root = "../public/train_bmp";
+    string teacher_path;       // 非空时进入蒸馏模式
+    float distill_alpha = 0.5f; // 软目标所占权重
+    float temperature = 2.0f;  // 软化教师与学生输出的温度
+    double holdout = -1.0;     // 蒸馏时留出不参与训练的比例，用于对比报告；未指定时为 0.1
+    string metrics_target;     // 非空时定期导出运行指标
+    MetricsFormat metrics_format = MetricsFormat::Prometheus;
+    double metrics_interval = 10.0;
+    for (int a = 1; a < argc; ++a)
+    {
+        string arg = argv[a];
+        if (arg == "--shuffle")
+            shuffle_data = true;
+        else if (arg == "--preprocess")
+            preprocess = true;
+        else if (arg == "--resume")
+            resume = true;
+        else if (a + 1 < argc && arg == "--epochs" && parseInt(argv[a + 1], epochs))
+            a++;
+        else if (a + 1 < argc && arg == "--seed" && parseUnsigned(argv[a + 1], seed))
+        {
+            seed_given = seed != 0;
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--precision")
+        {
+            string p = argv[++a];
+            if (p == "bf16" || p == "fp16")
+            {
+                mixed = true;
+                half_format = p == "bf16" ? HalfFormat::BF16 : HalfFormat::FP16;
+            }
+            else if (p != "fp32")
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (a + 1 < argc && arg == "--half-refresh" && parseInt(argv[a + 1], half_refresh))
+        {
+            half_refresh = max(1, half_refresh);
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--layout")
+        {
+            string l = argv[++a];
+            if (l != "blocked" && l != "rowmajor")
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            blocked_layout = l == "blocked";
+        }
+        else if (a + 1 < argc && arg == "--hidden" && parseInt(argv[a + 1], hidden_size))
+        {
+            hidden_size = max(1, hidden_size);
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--data")
+            data_root = argv[++a];
+        else if (a + 1 < argc && arg == "--out")
+            out_path = argv[++a];
+        else if (a + 1 < argc && arg == "--distill")
+            teacher_path = argv[++a];
+        else if (a + 1 < argc && arg == "--alpha" && parseFloat(argv[a + 1], distill_alpha))
+        {
+            distill_alpha = min(1.0f, max(0.0f, distill_alpha));
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--temperature" && parseFloat(argv[a + 1], temperature))
+        {
+            temperature = max(1e-3f, temperature);
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--holdout" && parseDouble(argv[a + 1], holdout))
+        {
+            holdout = min(0.9, max(0.0, holdout));
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--metrics")
+            metrics_target = argv[++a];
+        else if (a + 1 < argc && arg == "--metrics-format")
+        {
+            if (!parseMetricsFormat(argv[++a], metrics_format))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (a + 1 < argc && arg == "--metrics-interval" && parseDouble(argv[a + 1], metrics_interval))
+        {
+            metrics_interval = max(0.1, metrics_interval);
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--export-half")
+            export_half_path = argv[++a];
+        else if (a + 1 < argc && arg == "--checkpoint")
+            checkpoint_path = argv[++a];
+        else if (a + 1 < argc && arg == "--checkpoint-every" && parseInt(argv[a + 1], checkpoint_every))
+            a++;
+        else if (a + 1 < argc && arg == "--checkpoint-secs" && parseDouble(argv[a + 1], checkpoint_secs))
+            a++;
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // 留出的样本只用于蒸馏报告，普通训练留出只会少用数据
+    if (holdout >= 0 && teacher_path.empty())
+    {
+        cerr << "Error: --holdout is only used with --distill." << endl;
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 指标在进入循环前注册好，热路径上只做原子加
+    Histogram &forward_seconds = metrics().histogram("digits_train_forward_seconds", "Forward pass time per training sample");
+    Histogram &backward_seconds = metrics().histogram("digits_train_backward_seconds", "Backward pass and SGD update time per training sample");
+    Counter &samples_total = metrics().counter("digits_train_samples_total", "Training samples processed");
+    Counter &epochs_total = metrics().counter("digits_train_epochs_total", "Training epochs completed");
+    Gauge &samples_per_second = metrics().gauge("digits_train_samples_per_second", "Training throughput of the last epoch");
+    Gauge &epoch_loss = metrics().gauge("digits_train_epoch_loss", "Mean squared-error loss of the last epoch");
+    Gauge &epoch_accuracy = metrics().gauge("digits_train_epoch_accuracy", "Training accuracy of the last epoch");
+    unique_ptr<MetricsReporter> reporter;
+    if (!metrics_target.empty())
+        reporter.reset(new MetricsReporter(metrics_target, metrics_format, metrics_interval));
+
     // 1) 预先将所有图片读入内存
     vector<Sample> dataset;
-    dataset.reserve(10 * 500);
-    for (int label = 0; label < 10; ++label)
+    loadDataset(data_root, 500, dataset);
+    if (preprocess)
+        preprocessDataset(dataset);
+    // 蒸馏时按比例均匀留出一部分样本（数据集按类别排列，每类留出的比例相同），只用于最后的评估
+    if (holdout < 0)
+        holdout = teacher_path.empty() ? 0.0 : 0.1;
+    vector<Sample> heldout;
+    if (holdout > 0)
+    {
+        vector<Sample> train;
+        for (size_t n = 0; n < dataset.size(); n++)
+        {
+            if ((size_t)((n + 1) * holdout) > (size_t)(n * holdout))
+                heldout.push_back(move(dataset[n]));
+            else
+                train.push_back(move(dataset[n]));
+        }
+        dataset = move(train);
+    }
+    cout << "Loaded " << dataset.size() << " samples into memory";
+    if (!heldout.empty())
+        cout << " (" << heldout.size() << " more held out)";
+    cout << "\n";
+
+    // 蒸馏：只对训练集跑一次教师网络，缓存软化后的输出 sigmoid(z / T)；损失见 distillDelta
+    Layer teacherInputToHidden, teacherHiddenToOutput;
+    vector<vector<float>> soft_targets;
+    if (!teacher_path.empty())
     {
-        for (int idx = 1; idx <= 500; ++idx)
+        // 软目标在学生的输入上计算，教师必须用同样的预处理训练
+        ModelInfo teacher_info;
+        if (!loadModel(teacherInputToHidden, teacherHiddenToOutput, teacher_path, &teacher_info))
+            return 1;
+        if (teacher_info.has_flags && (bool)(teacher_info.flags & model_flag_preprocess) != preprocess)
+        {
+            cerr << "Error: Teacher " << teacher_path << " was trained " << (preprocess ? "without" : "with")
+                 << " --preprocess, the student " << (preprocess ? "with" : "without") << " it." << endl;
+            return 1;
+        }
+        soft_targets.reserve(dataset.size());
+        for (const auto &sample : dataset)
         {
-            string path = "../public/train_bmp/" + to_string(label) + "/" +
-                          to_string(label) + "_" + to_string(idx) + ".bmp";
-            vector<uint8_t> raw;
-            if (!readBMP(path, raw))
-                continue; // 读不到就跳过
+            vector<float> soft = forwardLogits(sample.input, teacherInputToHidden, teacherHiddenToOutput);
+            for (auto &z : soft)
+                z = sigmoid(z / temperature);
+            soft_targets.push_back(move(soft));
+        }
+        cout << "Cached teacher outputs from " << teacher_path << " (hidden "
+             << teacherInputToHidden.biases.size() << ", student hidden " << hidden_size << ")\n";
+    }
 
-            Sample s;
-            s.label = label;
-            s.input.resize(input_size);
-            // 假设 raw.size() == input_size
-            for (int i = 0; i < input_size; ++i)
-                s.input[i] = raw[i] / 255.0f;
-            dataset.push_back(move(s));
+    // 混合精度模式下输入也以 16 位保存，数据集占用减半
+    vector<vector<uint16_t>> inputs_half;
+    if (mixed)
+    {
+        inputs_half.resize(dataset.size());
+        for (size_t n = 0; n < dataset.size(); n++)
+        {
+            inputs_half[n].resize(input_size);
+            convertToHalf(dataset[n].input.data(), inputs_half[n].data(), input_size, half_format);
+            vector<float>().swap(dataset[n].input);
         }
     }
-    cout << "Loaded " << dataset.size() << " samples into memory\n";
 
     // 2) 初始化网络
     random_device rd;
-    mt19937 gen(rd());
+    if (!seed)
+        seed = rd();
+    mt19937 gen(seed);
     uniform_real_distribution<float> dis(-1.0f, 1.0f);
     Layer inputToHidden, hiddenToOutput;
     inputToHidden.weights.resize(input_size * hidden_size);
@@ -259,21 +916,237 @@ int main()
         w = dis(gen);
     hiddenToOutput.biases.assign(output_size, 0.0f);
 
+    vector<uint32_t> order(dataset.size());
+    iota(order.begin(), order.end(), 0);
+    int start_epoch = 0;
+    size_t start_position = 0;
+    uint32_t precision_id = mixed ? (uint32_t)half_format : 0;
+
+    // 混合精度的 16 位工作副本；恢复时取检查点中保存的副本，否则由初始权重生成
+    HalfWeights half;
+    int since_refresh = 0; // 上次刷新 16 位工作副本以来训练的样本数
+
+    // 从检查点恢复：权重、随机数状态、样本顺序与 16 位工作副本全部还原，保证逐位一致
+    if (resume)
+    {
+        Checkpoint ck;
+        if (!loadCheckpoint(ck, checkpoint_path))
+            return 1;
+        if (ck.data_root != data_root || ck.precision != precision_id || ck.preprocess != (uint32_t)preprocess)
+        {
+            cerr << "Error: Checkpoint " << checkpoint_path << " was written for --data " << ck.data_root
+                 << (ck.preprocess ? " --preprocess" : "") << " with precision "
+                 << (ck.precision == 0 ? "fp32" : ck.precision == (uint32_t)HalfFormat::BF16 ? "bf16" : "fp16") << endl;
+            return 1;
+        }
+        // 其余改变训练过程的设置也必须一致，否则续训得到的是另一个模型
+        ostringstream changed;
+        if (ck.shuffle != (uint32_t)shuffle_data)
+            changed << (ck.shuffle ? " --shuffle" : " (without --shuffle)");
+        if (mixed && ck.half_refresh != (uint32_t)half_refresh)
+            changed << " --half-refresh " << ck.half_refresh;
+        if (ck.holdout != holdout)
+            changed << " --holdout " << ck.holdout;
+        if (ck.teacher_path != teacher_path)
+            changed << (ck.teacher_path.empty() ? " (without --distill)" : " --distill " + ck.teacher_path);
+        else if (!teacher_path.empty() && (ck.distill_alpha != distill_alpha || ck.temperature != temperature))
+            changed << " --alpha " << ck.distill_alpha << " --temperature " << ck.temperature;
+        if (!changed.str().empty())
+        {
+            cerr << "Error: Checkpoint " << checkpoint_path << " was trained with" << changed.str() << endl;
+            return 1;
+        }
+        if (ck.order.size() != dataset.size() || ck.position > ck.order.size() ||
+            ck.inputToHidden.weights.size() != inputToHidden.weights.size() ||
+            ck.hiddenToOutput.weights.size() != hiddenToOutput.weights.size())
+        {
+            cerr << "Error: Checkpoint " << checkpoint_path << " does not match this dataset or network." << endl;
+            return 1;
+        }
+        if (ck.learning_rate != learning_rate)
+            cerr << "Warning: checkpoint was trained with learning rate " << ck.learning_rate << endl;
+        // 随机数状态已保存在检查点中，种子只用于核对；未指定 --seed 时沿用检查点的种子
+        if (seed_given && ck.seed != seed)
+        {
+            cerr << "Error: Checkpoint " << checkpoint_path << " was trained with --seed " << ck.seed << endl;
+            return 1;
+        }
+        seed = ck.seed;
+        istringstream rng_in(ck.rng_state);
+        rng_in >> gen;
+        order = move(ck.order);
+        inputToHidden = move(ck.inputToHidden);
+        hiddenToOutput = move(ck.hiddenToOutput);
+        half = move(ck.half);
+        since_refresh = ck.since_refresh;
+        start_epoch = ck.epoch;
+        start_position = ck.position;
+        cout << "Resumed from " << checkpoint_path << " at epoch " << start_epoch << ", sample " << start_position << "\n";
+    }
+
+    if (mixed && !resume)
+        refreshHalfWeights(inputToHidden, hiddenToOutput, half, half_format);
+
+    // fp32 训练使用分块布局，行优先的权重只在保存与检查点时还原
+    BlockedWeights blocked;
+    bool use_blocked = blocked_layout && !mixed;
+    if (use_blocked)
+    {
+        packBlocked(inputToHidden, blocked);
+        vector<float>().swap(inputToHidden.weights);
+    }
+
+    AsyncCheckpointer checkpointer(checkpoint_path);
+    auto last_checkpoint = chrono::steady_clock::now();
+    // 拷贝一份当前状态交给后台写线程；position 为本 epoch 已训练的样本数
+    auto submitCheckpoint = [&](uint32_t epoch, uint32_t position)
+    {
+        Checkpoint ck;
+        ck.epoch = epoch;
+        ck.position = position;
+        ck.learning_rate = learning_rate;
+        ck.seed = seed;
+        ck.precision = precision_id;
+        ck.preprocess = preprocess;
+        ck.shuffle = shuffle_data;
+        ck.half_refresh = half_refresh;
+        ck.since_refresh = since_refresh;
+        ck.distill_alpha = distill_alpha;
+        ck.temperature = temperature;
+        ck.holdout = holdout;
+        ck.data_root = data_root;
+        ck.teacher_path = teacher_path;
+        ostringstream rng_out;
+        rng_out << gen;
+        ck.rng_state = rng_out.str();
+        ck.order = order;
+        ck.inputToHidden.biases = inputToHidden.biases;
+        if (use_blocked)
+            unpackBlocked(blocked, ck.inputToHidden.weights);
+        else
+            ck.inputToHidden.weights = inputToHidden.weights;
+        ck.hiddenToOutput = hiddenToOutput;
+        ck.half = half;
+        checkpointer.submit(move(ck));
+    };
+
     // 3) 训练循环：只在内存中遍历 dataset，不再读文件
-    const int epochs = 500;
-    for (int epoch = 0; epoch < epochs; ++epoch)
+    for (int epoch = start_epoch; epoch < epochs; ++epoch)
     {
-        for (auto &sample : dataset)
+        // 从 epoch 中途的检查点恢复时，order 已是本 epoch 打乱后的顺序
+        size_t begin = epoch == start_epoch ? start_position : 0;
+        if (shuffle_data && begin == 0)
+            shuffle(order.begin(), order.end(), gen);
+        EpochStats stats;
+        auto epoch_start = chrono::steady_clock::now();
+        for (size_t pos = begin; pos < order.size(); pos++)
         {
-            auto fr = forwardPropagation(sample.input, inputToHidden, hiddenToOutput);
+            uint32_t idx = order[pos];
+            const Sample &sample = dataset[idx];
             auto target = getTarget(sample.label);
-            backwardPropagation(sample.input, fr, target,
-                                inputToHidden, hiddenToOutput);
+            ForwardResult fr;
+            auto t0 = chrono::steady_clock::now();
+            if (use_blocked)
+                fr = forwardPropagationBlocked(sample.input, blocked, inputToHidden, hiddenToOutput);
+            else if (!mixed)
+                fr = forwardPropagation(sample.input, inputToHidden, hiddenToOutput);
+            else if (half_format == HalfFormat::BF16)
+                fr = forwardPropagationMixed<HalfFormat::BF16>(inputs_half[idx], half, inputToHidden, hiddenToOutput);
+            else
+                fr = forwardPropagationMixed<HalfFormat::FP16>(inputs_half[idx], half, inputToHidden, hiddenToOutput);
+            auto t1 = chrono::steady_clock::now();
+
+            vector<float> output_delta = soft_targets.empty()
+                                             ? outputDelta(fr, target)
+                                             : distillDelta(fr, target, soft_targets[idx], distill_alpha, temperature);
+            if (use_blocked)
+                backwardPropagationBlocked(sample.input, fr, output_delta, blocked, inputToHidden, hiddenToOutput);
+            else if (!mixed)
+                backwardFromDelta(sample.input, fr, output_delta, inputToHidden, hiddenToOutput);
+            else if (half_format == HalfFormat::BF16)
+                backwardPropagationMixed<HalfFormat::BF16>(inputs_half[idx], fr, output_delta, inputToHidden, hiddenToOutput);
+            else
+                backwardPropagationMixed<HalfFormat::FP16>(inputs_half[idx], fr, output_delta, inputToHidden, hiddenToOutput);
+            if (mixed && ++since_refresh >= half_refresh)
+            {
+                refreshHalfWeights(inputToHidden, hiddenToOutput, half, half_format);
+                since_refresh = 0;
+            }
+            auto t2 = chrono::steady_clock::now();
+            forward_seconds.observe(chrono::duration<double>(t1 - t0).count());
+            backward_seconds.observe(chrono::duration<double>(t2 - t1).count());
+            stats.add(fr.output, target, sample.label);
+
+            // 按时间间隔的检查点在样本之间检查，长 epoch 中途也能写；epoch 的最后一个样本交给下面的 epoch 末尾检查
+            if (checkpoint_secs > 0 && pos + 1 < order.size() &&
+                chrono::duration<double>(t2 - last_checkpoint).count() >= checkpoint_secs)
+            {
+                submitCheckpoint(epoch, pos + 1);
+                last_checkpoint = t2;
+            }
         }
         cout << "Epoch " << (epoch + 1) << " completed\n";
+        double epoch_secs = chrono::duration<double>(chrono::steady_clock::now() - epoch_start).count();
+        samples_total.add(stats.samples);
+        epochs_total.add();
+        samples_per_second.set(stats.samples / epoch_secs);
+        epoch_loss.set(stats.samples ? stats.loss / stats.samples : 0.0);
+        epoch_accuracy.set(stats.samples ? (double)stats.correct / stats.samples : 0.0);
+
+        auto now = chrono::steady_clock::now();
+        bool due = (checkpoint_every > 0 && (epoch + 1) % checkpoint_every == 0) ||
+                   (checkpoint_secs > 0 && chrono::duration<double>(now - last_checkpoint).count() >= checkpoint_secs);
+        if (due && epoch + 1 < epochs)
+        {
+            submitCheckpoint(epoch + 1, 0);
+            last_checkpoint = now;
+        }
     }
+    checkpointer.finish();
+    if (use_blocked)
+        unpackBlocked(blocked, inputToHidden.weights);
 
     // 4) 保存模型
-    saveModel(inputToHidden, hiddenToOutput, "model.bin");
+    const uint32_t model_flags = preprocess ? model_flag_preprocess : 0;
+    saveModel(inputToHidden, hiddenToOutput, out_path, model_flags);
+
+    // 蒸馏报告：在留出的样本上对比学生与教师；没有留出时只能用训练集，报告中注明
+    if (!teacher_path.empty())
+    {
+        vector<vector<float>> inputs;
+        vector<int> labels;
+        if (!heldout.empty())
+        {
+            for (const auto &sample : heldout)
+            {
+                inputs.push_back(sample.input);
+                labels.push_back(sample.label);
+            }
+        }
+        else
+        {
+            for (size_t n = 0; n < dataset.size(); n++)
+            {
+                vector<float> x(input_size);
+                if (mixed)
+                    convertToFloat(inputs_half[n].data(), x.data(), input_size, half_format);
+                else
+                    x = dataset[n].input;
+                inputs.push_back(move(x));
+                labels.push_back(dataset[n].label);
+            }
+        }
+        ModelReport teacher = evaluateModel(inputs, labels, teacherInputToHidden, teacherHiddenToOutput);
+        ModelReport student = evaluateModel(inputs, labels, inputToHidden, hiddenToOutput);
+        cout << "Distillation report on " << inputs.size() << (heldout.empty() ? " training" : " held-out") << " samples\n";
+        cout << "          accuracy   params   size(KB)   latency(us)\n";
+        for (auto &row : {make_pair("teacher", teacher), make_pair("student", student)})
+        {
+            cout << row.first << "   " << row.second.accuracy * 100 << "%   " << row.second.parameters << "   "
+                 << row.second.parameters * sizeof(float) / 1024.0 << "   " << row.second.latency_us << "\n";
+        }
+    }
+    if (!export_half_path.empty())
+        saveHalfModel(inputToHidden, hiddenToOutput, export_half_path, half_format, model_flags);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,410 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <random>
+
+#include "core/args.h"
+#include "core/dataset.h"
+#include "core/model_io.h"
+#include "core/network.h"
+#include "core/preprocess.h"
+#include "core/segment.h"
+using namespace std;
+
+// 单条样本的评估结果
+struct Prediction
+{
+    int predicted;
+    float confidence; // 预测类别的输出值
+    float label_score; // 真实类别的输出值
+    double latency_us;
+};
+
+double percentile(vector<double> values, double p)
+{
+    if (values.empty())
+        return 0.0;
+    size_t k = min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+string jsonEscape(const string &s)
+{
+    string out;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+// 多位数字切分的检查结果（一种放大倍数）
+struct StripReport
+{
+    int scale = 1;
+    int strips = 0, strips_correct = 0;
+    int digits = 0;
+    int miscounted = 0;        // 切出的数字个数不对的图片数
+    int original_correct = 0;  // 直接识别原图
+    int segmented_correct = 0; // 切分、裁剪后识别
+    double original_confidence = 0, segmented_confidence = 0; // 真实类别输出值之和
+};
+
+// 从数据集随机取 length 个数字合成一行（见 composeStrip），用 read --multi 的流程切分、裁剪后识别，
+// 与直接识别这些原图对比。dataset 为未预处理的图片；preprocess 时两边都先预处理
+StripReport checkStrips(const vector<Sample> &dataset, int count, int length, int scale, bool preprocess,
+                        const Layer &inputToHidden, const Layer &hiddenToOutput)
+{
+    StripReport report;
+    report.scale = scale;
+    mt19937 gen(scale);
+    uniform_int_distribution<size_t> pick(0, dataset.size() - 1);
+    vector<float> x(input_size);
+    vector<float> shifted(shift_count * input_size), scores(shift_count * output_size);
+    // 原图直接识别；切出的数字与 read --multi 相同，未预处理时在平移候选中取最有把握的一个
+    auto classify = [&](int label, int &correct, double &confidence, bool search_shifts)
+    {
+        vector<float> output;
+        if (preprocess)
+        {
+            preprocessDigit(x.data(), x.data());
+            output = predict(x.data(), inputToHidden, hiddenToOutput);
+        }
+        else if (search_shifts)
+        {
+            shiftedCopies(x.data(), shifted.data());
+            predictBatch(shifted.data(), shift_count, inputToHidden, hiddenToOutput, scores.data());
+            const float *best = scores.data() + bestShift(scores.data(), shift_count) * output_size;
+            output.assign(best, best + output_size);
+        }
+        else
+        {
+            output = predict(x.data(), inputToHidden, hiddenToOutput);
+        }
+        confidence += output[label];
+        bool ok = getPredictedDigit(output) == label;
+        correct += ok;
+        return ok;
+    };
+    for (int s = 0; s < count; s++)
+    {
+        vector<const Sample *> samples;
+        vector<const float *> digits;
+        for (int d = 0; d < length; d++)
+        {
+            samples.push_back(&dataset[pick(gen)]);
+            digits.push_back(samples.back()->input.data());
+        }
+        GrayImage image = composeStrip(digits, scale, 0);
+        Segmentation seg;
+        segmentDigits(image, SegmentMethod::Components, seg);
+        report.strips++;
+        report.digits += length;
+        bool found = (int)seg.digits.size() == length;
+        report.miscounted += !found;
+        bool all = found;
+        for (int d = 0; d < length; d++)
+        {
+            int label = samples[d]->label;
+            x = samples[d]->input;
+            classify(label, report.original_correct, report.original_confidence, false);
+            if (!found)
+                continue;
+            extractDigit(image, seg, d, x.data());
+            all = classify(label, report.segmented_correct, report.segmented_confidence, true) && all;
+        }
+        report.strips_correct += all;
+    }
+    return report;
+}
+
+void usage(const char *prog)
+{
+    cerr << "Usage: " << prog << " [--model model.bin] [--data ../public/train_bmp] [--per-class 500]\n"
+         << "       [--packed file] [--pack file] [--threads N] [--json eval.json] [--top 10] [--preprocess]\n"
+         << "       [--strips N] [--strip-length 8]\n";
+}
+
+int main(int argc, char **argv)
+{
+    string model_path = "model.bin";
+    string data_root = "../public/train_bmp";
+    string packed_path, pack_out, json_path = "eval.json";
+    int per_class = 500;
+    int threads = max(1u, thread::hardware_concurrency());
+    int top_k = 10;
+    int strips = 0;       // 大于 0 时另外检查多位数字切分：放大 1 倍和 2 倍各合成 N 张
+    int strip_length = 8; // 每张的数字个数
+    bool preprocess = false; // 模型记录了是否预处理时按模型，旧模型用 cv3 --preprocess 训练时需要
+
+    for (int a = 1; a < argc; ++a)
+    {
+        string arg = argv[a];
+        if (arg == "--preprocess")
+        {
+            preprocess = true;
+            continue;
+        }
+        if (a + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        if (arg == "--model")
+            model_path = argv[++a];
+        else if (arg == "--data")
+            data_root = argv[++a];
+        else if (arg == "--per-class" && parseInt(argv[a + 1], per_class))
+        {
+            per_class = max(1, per_class);
+            a++;
+        }
+        else if (arg == "--packed")
+            packed_path = argv[++a];
+        else if (arg == "--pack")
+            pack_out = argv[++a];
+        else if (arg == "--threads" && parseInt(argv[a + 1], threads))
+        {
+            threads = max(1, threads);
+            a++;
+        }
+        else if (arg == "--json")
+            json_path = argv[++a];
+        else if (arg == "--top" && parseInt(argv[a + 1], top_k))
+        {
+            top_k = max(0, top_k);
+            a++;
+        }
+        else if (arg == "--strips" && parseInt(argv[a + 1], strips))
+        {
+            strips = max(0, strips);
+            a++;
+        }
+        else if (arg == "--strip-length" && parseInt(argv[a + 1], strip_length))
+        {
+            strip_length = max(1, strip_length);
+            a++;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Layer inputToHidden, hiddenToOutput;
+    ModelInfo model_info;
+    if (!loadModel(inputToHidden, hiddenToOutput, model_path, &model_info) ||
+        !applyModelPreprocess(model_info, preprocess, model_path))
+        return 1;
+
+    // 1) 读入带标签的数据集
+    vector<Sample> dataset;
+    dataset.reserve(output_size * per_class);
+    if (!packed_path.empty())
+    {
+        if (!loadPacked(packed_path, dataset))
+            return 1;
+    }
+    else
+    {
+        loadDataset(data_root, per_class, dataset);
+    }
+    if (dataset.empty())
+    {
+        cerr << "Error: No samples loaded." << endl;
+        return 1;
+    }
+    if (!pack_out.empty() && savePacked(pack_out, dataset))
+        cout << "Packed " << dataset.size() << " samples into " << pack_out << endl;
+    // 切分检查要用未预处理的图片合成
+    vector<StripReport> strip_reports;
+    for (int scale = 1; strips > 0 && scale <= 2; scale++)
+        strip_reports.push_back(checkStrips(dataset, strips, strip_length, scale, preprocess, inputToHidden, hiddenToOutput));
+    if (preprocess)
+        preprocessDataset(dataset);
+
+    // 2) 多线程并行推理，每个线程处理一段连续的样本
+    vector<Prediction> predictions(dataset.size());
+    threads = min<int>(threads, dataset.size());
+    auto wall_start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+                             {
+            size_t begin = dataset.size() * t / threads;
+            size_t end = dataset.size() * (t + 1) / threads;
+            for (size_t n = begin; n < end; ++n)
+            {
+                auto start = chrono::steady_clock::now();
+                vector<float> output = predict(dataset[n].input, inputToHidden, hiddenToOutput);
+                int digit = getPredictedDigit(output);
+                auto stop = chrono::steady_clock::now();
+
+                Prediction &p = predictions[n];
+                p.predicted = digit;
+                p.confidence = output[digit];
+                p.label_score = output[dataset[n].label];
+                p.latency_us = chrono::duration<double, micro>(stop - start).count();
+            } });
+    }
+    for (auto &w : workers)
+        w.join();
+    double wall_s = chrono::duration<double>(chrono::steady_clock::now() - wall_start).count();
+
+    // 3) 汇总：混淆矩阵、每类准确率与延迟
+    vector<vector<int>> confusion(output_size, vector<int>(output_size, 0));
+    vector<vector<double>> class_latency(output_size);
+    vector<double> all_latency;
+    all_latency.reserve(dataset.size());
+    vector<size_t> mistakes;
+    int correct = 0;
+    for (size_t n = 0; n < dataset.size(); ++n)
+    {
+        const Prediction &p = predictions[n];
+        int label = dataset[n].label;
+        confusion[label][p.predicted]++;
+        class_latency[label].push_back(p.latency_us);
+        all_latency.push_back(p.latency_us);
+        if (p.predicted == label)
+            correct++;
+        else
+            mistakes.push_back(n);
+    }
+
+    // 最易混淆的样本：错误类别得分与真实类别得分差距最大的
+    sort(mistakes.begin(), mistakes.end(), [&](size_t a, size_t b)
+         { return predictions[a].confidence - predictions[a].label_score >
+                  predictions[b].confidence - predictions[b].label_score; });
+    if ((int)mistakes.size() > top_k)
+        mistakes.resize(top_k);
+
+    double accuracy = (double)correct / dataset.size();
+    double throughput = dataset.size() / wall_s;
+
+    // 4) 人类可读的摘要
+    cout << fixed << setprecision(2);
+    cout << "Samples: " << dataset.size() << "  Threads: " << threads << "\n";
+    cout << "Accuracy: " << accuracy * 100 << "% (" << correct << "/" << dataset.size() << ")\n";
+    cout << "Throughput: " << throughput << " images/s  Latency p50/p99: "
+         << percentile(all_latency, 0.5) << "/" << percentile(all_latency, 0.99) << " us\n\n";
+
+    cout << "Class  Accuracy  p50(us)  p99(us)\n";
+    for (int c = 0; c < output_size; ++c)
+    {
+        int total = class_latency[c].size();
+        double acc = total ? 100.0 * confusion[c][c] / total : 0.0;
+        cout << setw(5) << c << setw(9) << acc << "%" << setw(9) << percentile(class_latency[c], 0.5)
+             << setw(9) << percentile(class_latency[c], 0.99) << "\n";
+    }
+
+    cout << "\nConfusion matrix (rows: label, columns: predicted)\n     ";
+    for (int c = 0; c < output_size; ++c)
+        cout << setw(5) << c;
+    cout << "\n";
+    for (int r = 0; r < output_size; ++r)
+    {
+        cout << setw(5) << r;
+        for (int c = 0; c < output_size; ++c)
+            cout << setw(5) << confusion[r][c];
+        cout << "\n";
+    }
+
+    if (!mistakes.empty())
+    {
+        cout << "\nMost confused samples\n";
+        for (size_t n : mistakes)
+        {
+            const Prediction &p = predictions[n];
+            cout << "  " << dataset[n].source << "  label " << dataset[n].label << " -> " << p.predicted
+                 << " (" << p.confidence << " vs " << p.label_score << ")\n";
+        }
+    }
+
+    if (!strip_reports.empty())
+    {
+        cout << "\nSegmentation on synthetic strips of " << strip_length << " digits (read --multi pipeline)\n";
+        cout << "Scale  Strips  Miscounted  Strip acc  Digit acc (original -> segmented)  Mean label score\n";
+        for (const auto &r : strip_reports)
+        {
+            cout << setw(5) << r.scale << setw(8) << r.strips << setw(12) << r.miscounted << setw(10)
+                 << 100.0 * r.strips_correct / r.strips << "%" << setw(12) << 100.0 * r.original_correct / r.digits
+                 << "% -> " << 100.0 * r.segmented_correct / r.digits << "%" << setw(22) << fixed
+                 << setprecision(4) << r.original_confidence / r.digits << " -> "
+                 << r.segmented_confidence / r.digits << setprecision(2) << "\n";
+        }
+    }
+
+    // 5) JSON 报告
+    ofstream json(json_path);
+    if (!json)
+    {
+        cerr << "Error: Could not open file " << json_path << " for writing." << endl;
+        return 1;
+    }
+    json << fixed << setprecision(6);
+    json << "{\n  \"model\": \"" << jsonEscape(model_path) << "\",\n";
+    json << "  \"samples\": " << dataset.size() << ",\n";
+    json << "  \"threads\": " << threads << ",\n";
+    json << "  \"accuracy\": " << accuracy << ",\n";
+    json << "  \"throughput_images_per_s\": " << throughput << ",\n";
+    json << "  \"latency_us\": {\"p50\": " << percentile(all_latency, 0.5)
+         << ", \"p99\": " << percentile(all_latency, 0.99) << "},\n";
+    json << "  \"per_class\": [\n";
+    for (int c = 0; c < output_size; ++c)
+    {
+        int total = class_latency[c].size();
+        json << "    {\"label\": " << c << ", \"samples\": " << total
+             << ", \"accuracy\": " << (total ? (double)confusion[c][c] / total : 0.0)
+             << ", \"latency_p50_us\": " << percentile(class_latency[c], 0.5)
+             << ", \"latency_p99_us\": " << percentile(class_latency[c], 0.99) << "}"
+             << (c + 1 < output_size ? ",\n" : "\n");
+    }
+    json << "  ],\n  \"confusion\": [\n";
+    for (int r = 0; r < output_size; ++r)
+    {
+        json << "    [";
+        for (int c = 0; c < output_size; ++c)
+            json << confusion[r][c] << (c + 1 < output_size ? ", " : "");
+        json << "]" << (r + 1 < output_size ? ",\n" : "\n");
+    }
+    json << "  ],\n  \"most_confused\": [\n";
+    for (size_t k = 0; k < mistakes.size(); ++k)
+    {
+        size_t n = mistakes[k];
+        json << "    {\"source\": \"" << jsonEscape(dataset[n].source) << "\", \"label\": " << dataset[n].label
+             << ", \"predicted\": " << predictions[n].predicted << ", \"confidence\": " << predictions[n].confidence
+             << ", \"label_score\": " << predictions[n].label_score << "}"
+             << (k + 1 < mistakes.size() ? ",\n" : "\n");
+    }
+    json << "  ]";
+    if (!strip_reports.empty())
+    {
+        json << ",\n  \"strips\": [\n";
+        for (size_t k = 0; k < strip_reports.size(); ++k)
+        {
+            const StripReport &r = strip_reports[k];
+            json << "    {\"scale\": " << r.scale << ", \"strips\": " << r.strips << ", \"miscounted\": " << r.miscounted
+                 << ", \"strip_accuracy\": " << (double)r.strips_correct / r.strips
+                 << ", \"original_accuracy\": " << (double)r.original_correct / r.digits
+                 << ", \"segmented_accuracy\": " << (double)r.segmented_correct / r.digits << "}"
+                 << (k + 1 < strip_reports.size() ? ",\n" : "\n");
+        }
+        json << "  ]";
+    }
+    json << "\n}\n";
+    cout << "\nReport written to " << json_path << endl;
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+
+#include "core/args.h"
+#include "core/dataset.h"
+#include "core/model_io.h"
+#include "core/network.h"
+using namespace std;
+
+// 根据掩码把稠密权重压缩为 CSR
+Layer compress(const Layer &layer, const vector<uint8_t> &mask)
+{
+    const int hidden_size = layer.biases.size();
+    Layer sparse;
+    sparse.row_ptr.push_back(0);
+    for (int h = 0; h < hidden_size; h++)
+    {
+        for (int i = 0; i < input_size; i++)
+        {
+            if (mask[i + h * input_size])
+            {
+                sparse.cols.push_back(i);
+                sparse.weights.push_back(layer.weights[i + h * input_size]);
+            }
+        }
+        sparse.row_ptr.push_back(sparse.weights.size());
+    }
+    sparse.biases = layer.biases;
+    return sparse;
+}
+
+// 在数据集上测量准确率和单张图片的平均延迟（微秒）；先跑一遍预热缓存，再计时
+template <typename Forward>
+void measure(const vector<Sample> &dataset, Forward forward, double &accuracy, double &latency_us)
+{
+    for (const auto &sample : dataset)
+        forward(sample.input);
+    int correct = 0;
+    auto start = chrono::steady_clock::now();
+    for (const auto &sample : dataset)
+    {
+        if (getPredictedDigit(forward(sample.input)) == sample.label)
+            correct++;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    accuracy = (double)correct / dataset.size();
+    latency_us = seconds * 1e6 / dataset.size();
+}
+
+void usage(const char *prog)
+{
+    cerr << "Usage: " << prog << " [--model model.bin] [--out model_sparse.bin] [--data ../public/train_bmp]\n"
+         << "       [--sparsity 0.5 | --threshold T] [--finetune EPOCHS] [--holdout 0.2] [--preprocess]\n";
+}
+
+int main(int argc, char **argv)
+{
+    string model_path = "model.bin";
+    string out_path = "model_sparse.bin";
+    string data_root = "../public/train_bmp";
+    double sparsity = 0.5;   // 在非恒定输入的连接中剪掉的比例
+    float threshold = -1.0f; // 大于等于 0 时改用固定阈值
+    int finetune_epochs = 2;
+    double holdout = 0.2; // 留出不参与剪枝统计与微调的比例，准确率在这部分上测量
+    bool preprocess = false; // 模型记录了是否预处理时按模型，旧模型用 cv3 --preprocess 训练时需要
+    for (int a = 1; a < argc; ++a)
+    {
+        string arg = argv[a];
+        if (arg == "--preprocess")
+        {
+            preprocess = true;
+            continue;
+        }
+        if (a + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        if (arg == "--model")
+            model_path = argv[++a];
+        else if (arg == "--out")
+            out_path = argv[++a];
+        else if (arg == "--data")
+            data_root = argv[++a];
+        else if (arg == "--sparsity" && parseDouble(argv[a + 1], sparsity))
+        {
+            sparsity = min(1.0, max(0.0, sparsity));
+            a++;
+        }
+        else if (arg == "--threshold" && parseFloat(argv[a + 1], threshold))
+            a++;
+        else if (arg == "--finetune" && parseInt(argv[a + 1], finetune_epochs))
+            a++;
+        else if (arg == "--holdout" && parseDouble(argv[a + 1], holdout))
+        {
+            holdout = min(0.9, max(0.0, holdout));
+            a++;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Layer inputToHidden, hiddenToOutput;
+    ModelInfo model_info;
+    if (!loadModel(inputToHidden, hiddenToOutput, model_path, &model_info) ||
+        !applyModelPreprocess(model_info, preprocess, model_path))
+        return 1;
+    if (!inputToHidden.row_ptr.empty())
+    {
+        cerr << "Error: " << model_path << " is already sparse." << endl;
+        return 1;
+    }
+    // 剪枝与微调直接修改权重，半精度模型先展开
+    expandHalfWeights(inputToHidden);
+    expandHalfWeights(hiddenToOutput);
+    const int hidden_size = inputToHidden.biases.size();
+
+    // 1) 读入数据集，按 holdout 比例均匀留出评估集（数据集按类别排列，每类留出的比例相同）
+    vector<Sample> all;
+    loadDataset(data_root, 500, all);
+    if (preprocess)
+        preprocessDataset(all);
+    vector<Sample> dataset, heldout;
+    for (size_t n = 0; n < all.size(); n++)
+    {
+        if ((size_t)((n + 1) * holdout) > (size_t)(n * holdout))
+            heldout.push_back(move(all[n]));
+        else
+            dataset.push_back(move(all[n]));
+    }
+    if (dataset.empty())
+    {
+        cerr << "Error: No samples loaded." << endl;
+        return 1;
+    }
+    cout << "Loaded " << dataset.size() << " training and " << heldout.size() << " held-out samples into memory\n";
+    // 不留出时只能在微调用的训练集上评估，报告中注明
+    const vector<Sample> &evaluation = heldout.empty() ? dataset : heldout;
+    const char *evaluation_name = heldout.empty() ? "training" : "held-out";
+
+    // 稠密与稀疏模型都用推理路径 predict 计时，只比较 CSR 带来的差别
+    double dense_accuracy, dense_latency;
+    measure(evaluation, [&](const vector<float> &x)
+            { return predict(x, inputToHidden, hiddenToOutput); },
+            dense_accuracy, dense_latency);
+
+    // 2) 找出在训练集上取值恒定的输入（背景像素），
+    //    其贡献 w * c 并入偏置后整列删除
+    vector<uint8_t> mask(input_size * hidden_size, 1);
+    int constant_inputs = 0;
+    for (int i = 0; i < input_size; i++)
+    {
+        float c = dataset[0].input[i];
+        bool constant = all_of(dataset.begin(), dataset.end(), [&](const Sample &s)
+                               { return s.input[i] == c; });
+        if (!constant)
+            continue;
+        constant_inputs++;
+        for (int h = 0; h < hidden_size; h++)
+        {
+            inputToHidden.biases[h] += inputToHidden.weights[i + h * input_size] * c;
+            inputToHidden.weights[i + h * input_size] = 0.0f;
+            mask[i + h * input_size] = 0;
+        }
+    }
+
+    // 3) 按绝对值剪枝：剩余连接中绝对值最小的 sparsity 比例置零
+    if (threshold < 0.0f)
+    {
+        vector<float> magnitudes;
+        for (size_t k = 0; k < mask.size(); k++)
+        {
+            if (mask[k])
+                magnitudes.push_back(fabs(inputToHidden.weights[k]));
+        }
+        size_t cut = (size_t)(sparsity * magnitudes.size());
+        if (cut == 0)
+            threshold = 0.0f;
+        else
+        {
+            nth_element(magnitudes.begin(), magnitudes.begin() + (cut - 1), magnitudes.end());
+            threshold = nextafter(magnitudes[cut - 1], INFINITY);
+        }
+    }
+    for (size_t k = 0; k < mask.size(); k++)
+    {
+        if (mask[k] && fabs(inputToHidden.weights[k]) < threshold)
+        {
+            mask[k] = 0;
+            inputToHidden.weights[k] = 0.0f;
+        }
+    }
+
+    // 4) 可选微调：普通 SGD，每步后把被剪掉的连接重新置零
+    for (int epoch = 0; epoch < finetune_epochs; ++epoch)
+    {
+        for (const auto &sample : dataset)
+        {
+            auto fr = forwardPropagation(sample.input, inputToHidden, hiddenToOutput);
+            auto target = getTarget(sample.label);
+            backwardPropagation(sample.input, fr, target, inputToHidden, hiddenToOutput);
+            for (size_t k = 0; k < mask.size(); k++)
+                inputToHidden.weights[k] *= mask[k];
+        }
+        cout << "Fine-tune epoch " << (epoch + 1) << " completed\n";
+    }
+
+    // 5) 压缩为 CSR 并报告
+    Layer sparse = compress(inputToHidden, mask);
+    double sparse_accuracy, sparse_latency;
+    measure(evaluation, [&](const vector<float> &x)
+            { return predict(x, sparse, hiddenToOutput); },
+            sparse_accuracy, sparse_latency);
+
+    size_t total = (size_t)input_size * hidden_size;
+    cout << fixed << setprecision(2);
+    cout << "Constant inputs removed: " << constant_inputs << " of " << input_size << "\n";
+    cout << "Magnitude threshold: " << setprecision(6) << threshold << setprecision(2) << "\n";
+    cout << "inputToHidden non-zeros: " << sparse.weights.size() << " of " << total << " ("
+         << 100.0 * (total - sparse.weights.size()) / total << "% sparse)\n";
+    cout << "Accuracy on " << evaluation.size() << " " << evaluation_name << " samples: dense " << dense_accuracy * 100 << "%, sparse " << sparse_accuracy * 100
+         << "% (delta " << (sparse_accuracy - dense_accuracy) * 100 << " points)\n";
+    cout << "Latency per image: dense " << dense_latency << " us, sparse " << sparse_latency
+         << " us (" << dense_latency / sparse_latency << "x)\n";
+
+    return saveSparseModel(sparse, hiddenToOutput, out_path, preprocess ? model_flag_preprocess : 0) ? 0 : 1;
+}
@@ -4,199 +4,559 @@
 #include <cstring>
 #include <cmath>
 #include <string>
-using namespace std;
+#include <array>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
-const int input_size = 784;
-const int hidden_size = 256;
-const int output_size = 10;
+#include "core/args.h"
+#include "core/async_io.h"
+#include "core/bmp.h"
+#include "core/metrics.h"
+#include "core/model_io.h"
+#include "core/network.h"
+#include "core/preprocess.h"
+#include "core/segment.h"
+using namespace std;
 
-// BMP文件头结构
-#pragma pack(push, 1)
-struct BMPHeader
+// 对 784 字节像素做快速 64 位哈希：每次处理 8 字节，乘法加移位混合
+uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t seed = 0)
 {
-    char bfType[2];
-    uint32_t bfSize;
-    uint16_t bfReserved1;
-    uint16_t bfReserved2;
-    uint32_t bfOffBits;
-};
+    const uint64_t k = 0x9E3779B97F4A7C15ull;
+    uint64_t h = seed ^ (size * k);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, data + i, sizeof(w));
+        h = (h ^ w) * k;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i);
+    h = (h ^ tail) * k;
+    return h ^ (h >> 29);
+}
 
-struct BMPInfoHeader
+// 缓存的预测结果
+struct CachedPrediction
 {
-    uint32_t biSize;
-    int32_t biWidth;
-    int32_t biHeight;
-    uint16_t biPlanes;
-    uint16_t biBitCount;
-    uint32_t biCompression;
-    uint32_t biSizeImage;
-    int32_t biXPelsPerMeter;
-    int32_t biYPelsPerMeter;
-    uint32_t biClrUsed;
-    uint32_t biClrImportant;
+    int digit;
+    array<float, output_size> scores;
 };
-#pragma pack(pop)
 
-// 读取BMP文件
-bool readBMP(const string &filename, vector<uint8_t> &pixelData)
+// 有界、线程安全的 LRU 预测缓存。按哈希分成若干分片，每片独立加锁；
+// 条目保存完整像素用于比对，哈希碰撞不会返回错误结果。
+// 缓存只存在于本进程内，而进程只在启动时加载一次模型，所以键只需像素哈希
+class PredictionCache
 {
-    BMPHeader bmpHeader;
-    BMPInfoHeader bmpInfoHeader;
+public:
+    explicit PredictionCache(size_t capacity) : shard_capacity_(max<size_t>(1, (capacity + shard_count - 1) / shard_count)) {}
 
-    ifstream inputFile(filename, ios::binary);
-    if (!inputFile)
+    bool lookup(const vector<uint8_t> &pixels, uint64_t key, CachedPrediction &out)
     {
-        cerr << "Error: Could not open file " << filename << endl;
-        return false;
+        Shard &shard = shards_[key % shard_count];
+        lock_guard<mutex> lock(shard.mtx);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end() || it->second->pixels != pixels)
+        {
+            misses_.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        out = it->second->value;
+        hits_.fetch_add(1, memory_order_relaxed);
+        return true;
     }
 
-    inputFile.read(reinterpret_cast<char *>(&bmpHeader), sizeof(bmpHeader));
-    if (bmpHeader.bfType[0] != 'B' || bmpHeader.bfType[1] != 'M')
+    void insert(const vector<uint8_t> &pixels, uint64_t key, const CachedPrediction &value)
     {
-        cerr << "Error: Not a valid BMP file." << endl;
-        return false;
+        Shard &shard = shards_[key % shard_count];
+        lock_guard<mutex> lock(shard.mtx);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+            it->second->pixels = pixels;
+            it->second->value = value;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return;
+        }
+        if (shard.lru.size() >= shard_capacity_)
+        {
+            shard.index.erase(shard.lru.back().key);
+            shard.lru.pop_back();
+            evictions_.fetch_add(1, memory_order_relaxed);
+        }
+        shard.lru.push_front(Entry{key, pixels, value});
+        shard.index[key] = shard.lru.begin();
     }
 
-    inputFile.read(reinterpret_cast<char *>(&bmpInfoHeader), sizeof(bmpInfoHeader));
+    uint64_t hits() const { return hits_.load(memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(memory_order_relaxed); }
+    uint64_t evictions() const { return evictions_.load(memory_order_relaxed); }
+    double hitRate() const
+    {
+        uint64_t total = hits() + misses();
+        return total ? (double)hits() / total : 0.0;
+    }
 
-    inputFile.seekg(bmpHeader.bfOffBits, ios::beg);
-    int rowSize = ((bmpInfoHeader.biWidth * bmpInfoHeader.biBitCount + 31) / 32) * 4;
-    int imageSize = rowSize * abs(bmpInfoHeader.biHeight);
-    pixelData.resize(imageSize);
-    inputFile.read(reinterpret_cast<char *>(pixelData.data()), imageSize);
+private:
+    static const size_t shard_count = 16;
 
-    inputFile.close();
-    return true;
-}
+    struct Entry
+    {
+        uint64_t key;
+        vector<uint8_t> pixels;
+        CachedPrediction value;
+    };
 
-struct Layer
-{
-    vector<float> weights;
-    vector<float> biases;
+    struct Shard
+    {
+        mutex mtx;
+        list<Entry> lru; // 表头为最近使用
+        unordered_map<uint64_t, list<Entry>::iterator> index;
+    };
+
+    size_t shard_capacity_;
+    array<Shard, shard_count> shards_;
+    atomic<uint64_t> hits_{0}, misses_{0}, evictions_{0};
 };
 
-float sigmoid(float x)
+// 把缓冲区完整写出；管道下游变慢时 write 阻塞，形成背压
+bool writeAll(int fd, const char *data, size_t size)
 {
-    return 1.0f / (1.0f + exp(-x));
+    while (size > 0)
+    {
+        ssize_t n = write(fd, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
 }
 
-// 前向传播函数（简化版，仅需输出）
-vector<float> forwardPropagation(const vector<float> &input,
-                                 const Layer &inputToHidden,
-                                 const Layer &hiddenToOutput)
+// 流式推理：从 fd 读取连续的记录（原始 784 字节或完整 BMP 文件），
+// 凑成微批后一次前向传播，结果以 CSV 或每条 1 字节的二进制写到 stdout。
+// 内存占用由 batch 上限决定，不会随输入增长
+int runStream(int fd, bool bmp_input, bool binary_output, int batch, bool preprocess,
+              const Layer &inputToHidden, const Layer &hiddenToOutput,
+              PredictionCache &cache, bool use_cache)
 {
-    vector<float> hidden(hidden_size);
-    for (int h = 0; h < hidden_size; h++)
+    const size_t max_record = bmp_input ? 64 * 1024 : input_size;
+    vector<uint8_t> buffer((size_t)batch * (bmp_input ? 2048 : input_size) + max_record);
+    size_t filled = 0;
+    bool eof = false;
+
+    vector<vector<uint8_t>> records(batch);
+    vector<uint64_t> keys(batch);
+    vector<int> digits(batch);
+    vector<float> scores((size_t)batch * output_size);
+    vector<float> inputs((size_t)batch * input_size);
+    vector<float> batch_out((size_t)batch * output_size);
+    vector<int> pending; // 批内未命中缓存的记录
+    string out;
+    uint64_t index = 0;
+
+    Histogram &batch_seconds = metrics().histogram("digits_inference_batch_seconds", "Forward pass time per stream micro-batch");
+    Counter &predictions = metrics().counter("digits_predictions_total", "Images classified");
+    Gauge &buffered_bytes = metrics().gauge("digits_stream_buffered_bytes", "Input bytes read but not yet consumed");
+    Gauge &batch_depth = metrics().gauge("digits_stream_batch_depth", "Records in the micro-batch being processed");
+
+    while (!eof || filled > 0)
     {
-        float sum = 0.0f;
-        for (int i = 0; i < input_size; i++)
+        // 阻塞读取：有多少读多少，不等凑满整批
+        if (!eof && filled < buffer.size())
+        {
+            ssize_t n = read(fd, buffer.data() + filled, buffer.size() - filled);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                cerr << "Error: read failed: " << strerror(errno) << endl;
+                return 1;
+            }
+            if (n == 0)
+                eof = true;
+            filled += n;
+        }
+
+        // 切分出完整记录
+        size_t consumed = 0;
+        int count = 0;
+        while (count < batch)
+        {
+            size_t available = filled - consumed;
+            long size;
+            if (bmp_input)
+            {
+                size = parseBMP(buffer.data() + consumed, available, records[count]);
+                if (size < 0 || (size == 0 && available >= max_record))
+                {
+                    cerr << "Error: Invalid BMP record at index " << index + count << endl;
+                    return 1;
+                }
+            }
+            else
+            {
+                size = available >= (size_t)input_size ? input_size : 0;
+                if (size)
+                    records[count].assign(buffer.data() + consumed, buffer.data() + consumed + input_size);
+            }
+            if (size == 0)
+                break;
+            consumed += size;
+            count++;
+        }
+        memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+        filled -= consumed;
+        buffered_bytes.set(filled);
+        batch_depth.set(count);
+        if (count == 0)
+        {
+            if (eof && filled > 0)
+            {
+                cerr << "Warning: Dropped " << filled << " trailing bytes of an incomplete record" << endl;
+                filled = 0;
+            }
+            continue;
+        }
+
+        // 先查缓存，剩下的样本组成一个批次做前向传播
+        pending.clear();
+        for (int b = 0; b < count; b++)
+        {
+            CachedPrediction cached;
+            if (use_cache)
+            {
+                keys[b] = hashBytes(records[b].data(), records[b].size());
+                if (cache.lookup(records[b], keys[b], cached))
+                {
+                    digits[b] = cached.digit;
+                    copy(cached.scores.begin(), cached.scores.end(), scores.begin() + (size_t)b * output_size);
+                    continue;
+                }
+            }
+            float *x = inputs.data() + pending.size() * input_size;
+            for (int i = 0; i < input_size; i++)
+                x[i] = records[b][i] / 255.0f;
+            if (preprocess)
+                preprocessDigit(x, x);
+            pending.push_back(b);
+        }
+
+        auto batch_start = chrono::steady_clock::now();
+        predictBatch(inputs.data(), pending.size(), inputToHidden, hiddenToOutput, batch_out.data());
+        if (!pending.empty())
+            batch_seconds.observe(chrono::duration<double>(chrono::steady_clock::now() - batch_start).count());
+        predictions.add(count);
+        for (size_t k = 0; k < pending.size(); k++)
+        {
+            int b = pending[k];
+            const float *output = batch_out.data() + k * output_size;
+            float *score = scores.data() + (size_t)b * output_size;
+            copy(output, output + output_size, score);
+            digits[b] = max_element(score, score + output_size) - score;
+            if (use_cache)
+            {
+                CachedPrediction value;
+                value.digit = digits[b];
+                copy(output, output + output_size, value.scores.begin());
+                cache.insert(records[b], keys[b], value);
+            }
+        }
+
+        // 每个微批写一次
+        out.clear();
+        for (int b = 0; b < count; b++, index++)
+        {
+            if (binary_output)
+            {
+                out.push_back((char)digits[b]);
+            }
+            else
+            {
+                char line[64];
+                int len = snprintf(line, sizeof(line), "%llu,%d,%.4f\n", (unsigned long long)index,
+                                   digits[b], scores[(size_t)b * output_size + digits[b]]);
+                out.append(line, len);
+            }
+        }
+        if (!writeAll(STDOUT_FILENO, out.data(), out.size()))
         {
-            sum += input[i] * inputToHidden.weights[i + h * input_size];
+            cerr << "Error: write failed: " << strerror(errno) << endl;
+            return 1;
         }
-        hidden[h] = sigmoid(sum + inputToHidden.biases[h]);
     }
+    return 0;
+}
+
+// 多位数字模式：切分大图中的所有数字，裁剪全部完成后再批量前向传播
+// （按 batch 分块，使一块输入留在缓存中）。
+// 每个文本行输出一行：识别出的数字串，随后是每位数字的置信度（预测类别的输出值）
+int runMulti(const string &path, SegmentMethod method, bool preprocess, int batch,
+             const Layer &inputToHidden, const Layer &hiddenToOutput)
+{
+    auto start = chrono::steady_clock::now();
+    GrayImage image;
+    if (!readGrayBMP(path, image))
+        return 1;
 
-    vector<float> output(output_size);
-    for (int o = 0; o < output_size; o++)
+    Segmentation seg;
+    segmentDigits(image, method, seg);
+    size_t count = seg.digits.size();
+    // 每个数字取 shift_count 个平移候选；预处理会按质心重新居中，只需一个
+    const int candidates = preprocess ? 1 : shift_count;
+    size_t total = count * candidates;
+    vector<float> inputs(total * input_size), digit(input_size);
+    for (size_t d = 0; d < count; d++)
     {
-        float sum = 0.0f;
-        for (int h = 0; h < hidden_size; h++)
+        float *x = inputs.data() + d * candidates * input_size;
+        if (preprocess)
         {
-            sum += hidden[h] * hiddenToOutput.weights[h + o * hidden_size];
+            extractDigit(image, seg, d, x);
+            preprocessDigit(x, x);
+        }
+        else
+        {
+            extractDigit(image, seg, d, digit.data());
+            shiftedCopies(digit.data(), x);
         }
-        output[o] = sigmoid(sum + hiddenToOutput.biases[o]);
     }
+    auto segmented = chrono::steady_clock::now();
 
-    return output;
-}
+    vector<float> scores(total * output_size);
+    for (size_t k = 0; k < total; k += batch)
+    {
+        int n = min((size_t)batch, total - k);
+        predictBatch(inputs.data() + k * input_size, n, inputToHidden, hiddenToOutput, scores.data() + k * output_size);
+    }
+    auto finished = chrono::steady_clock::now();
 
-// 加载模型
-bool loadModel(Layer &inputToHidden, Layer &hiddenToOutput, const string &filename)
-{
-    ifstream inFile(filename, ios::binary);
-    if (!inFile)
+    string text, confidences;
+    for (size_t d = 0; d < count; d++)
     {
-        cerr << "Error: Could not open file " << filename << " for reading." << endl;
-        return false;
+        const float *candidate_scores = scores.data() + d * candidates * output_size;
+        const float *best = candidate_scores + bestShift(candidate_scores, candidates) * output_size;
+        vector<float> output(best, best + output_size);
+        int digit = getPredictedDigit(output);
+        char conf[16];
+        snprintf(conf, sizeof(conf), " %.4f", output[digit]);
+        text += (char)('0' + digit);
+        confidences += conf;
+        if (d + 1 == count || seg.digits[d + 1].line != seg.digits[d].line)
+        {
+            cout << text << confidences << "\n";
+            text.clear();
+            confidences.clear();
+        }
     }
+    cout.flush();
+    metrics().counter("digits_predictions_total", "Images classified").add(count);
 
-    // 读取输入到隐藏层的权重和偏置
-    uint32_t weights_size, biases_size;
-    inFile.read(reinterpret_cast<char *>(&weights_size), sizeof(weights_size));
-    inFile.read(reinterpret_cast<char *>(&biases_size), sizeof(biases_size));
-    inputToHidden.weights.resize(weights_size);
-    inputToHidden.biases.resize(biases_size);
-    inFile.read(reinterpret_cast<char *>(inputToHidden.weights.data()), weights_size * sizeof(float));
-    inFile.read(reinterpret_cast<char *>(inputToHidden.biases.data()), biases_size * sizeof(float));
-
-    // 读取隐藏到输出层的权重和偏置
-    inFile.read(reinterpret_cast<char *>(&weights_size), sizeof(weights_size));
-    inFile.read(reinterpret_cast<char *>(&biases_size), sizeof(biases_size));
-    hiddenToOutput.weights.resize(weights_size);
-    hiddenToOutput.biases.resize(biases_size);
-    inFile.read(reinterpret_cast<char *>(hiddenToOutput.weights.data()), weights_size * sizeof(float));
-    inFile.read(reinterpret_cast<char *>(hiddenToOutput.biases.data()), biases_size * sizeof(float));
-
-    inFile.close();
-    cout << "Model loaded from " << filename << endl;
-    return true;
+    cerr << "Recognized " << count << " digits in " << image.width << "x" << image.height << " image: segment "
+         << chrono::duration<double, milli>(segmented - start).count() << " ms, forward "
+         << chrono::duration<double, milli>(finished - segmented).count() << " ms" << endl;
+    return 0;
 }
 
-// 找到输出中最大值的索引
-int getPredictedDigit(const vector<float> &output)
+void usage(const char *prog)
 {
-    int max_index = 0;
-    float max_value = output[0];
-    for (int i = 1; i < output_size; i++)
+    cerr << "Usage: " << prog << " [--model model.bin] [--cache N] [--passes 1] [--preprocess]\n"
+         << "       [--io auto|uring|threads] [--io-depth 256]\n"
+         << "       " << prog << " --stream -|FIFO [--input raw|bmp] [--output csv|binary] [--batch 64]\n"
+         << "       " << prog << " --multi FORM.bmp [--segment components|columns] [--batch 64]\n"
+         << "       [--metrics FILE|unix:SOCKET] [--metrics-format prometheus|json] [--metrics-interval 10]\n";
+}
+
+int main(int argc, char **argv)
+{
+    string model_path = "model.bin";
+    size_t cache_capacity = 0; // 0 表示不使用缓存
+    int passes = 1;            // 重复遍历数据集的次数，用于模拟重复提交
+    string stream_path;        // 非空时进入流式模式，"-" 表示 stdin
+    bool bmp_input = false;
+    bool binary_output = false;
+    int batch = 64;
+    bool preprocess = false; // 模型记录了是否预处理时按模型，旧模型用 cv3 --preprocess 训练时需要
+    string multi_path;       // 非空时进入多位数字模式
+    IoBackend io_backend = IoBackend::Auto; // 默认模式下读取图片的方式
+    unsigned io_depth = 256;                // 同时在读的文件数
+    SegmentMethod segment_method = SegmentMethod::Components;
+    string metrics_target; // 非空时定期导出运行指标
+    MetricsFormat metrics_format = MetricsFormat::Prometheus;
+    double metrics_interval = 10.0;
+    for (int a = 1; a < argc; ++a)
     {
-        if (output[i] > max_value)
+        string arg = argv[a];
+        if (arg == "--preprocess")
+            preprocess = true;
+        else if (a + 1 < argc && arg == "--model")
+            model_path = argv[++a];
+        else if (a + 1 < argc && arg == "--cache" && parseSize(argv[a + 1], cache_capacity))
+            a++;
+        else if (a + 1 < argc && arg == "--passes" && parseInt(argv[a + 1], passes))
+        {
+            passes = max(1, passes);
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--stream")
+            stream_path = argv[++a];
+        else if (a + 1 < argc && arg == "--input" && (string(argv[a + 1]) == "raw" || string(argv[a + 1]) == "bmp"))
+            bmp_input = string(argv[++a]) == "bmp";
+        else if (a + 1 < argc && arg == "--output" && (string(argv[a + 1]) == "csv" || string(argv[a + 1]) == "binary"))
+            binary_output = string(argv[++a]) == "binary";
+        else if (a + 1 < argc && arg == "--multi")
+            multi_path = argv[++a];
+        else if (a + 1 < argc && arg == "--segment" && (string(argv[a + 1]) == "components" || string(argv[a + 1]) == "columns"))
+            segment_method = string(argv[++a]) == "columns" ? SegmentMethod::Columns : SegmentMethod::Components;
+        else if (a + 1 < argc && arg == "--io" && parseIoBackend(argv[a + 1], io_backend))
+            a++;
+        else if (a + 1 < argc && arg == "--io-depth" && parseUnsigned(argv[a + 1], io_depth))
+        {
+            io_depth = max(1u, io_depth);
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--batch" && parseInt(argv[a + 1], batch))
+        {
+            batch = max(1, batch);
+            a++;
+        }
+        else if (a + 1 < argc && arg == "--metrics")
+            metrics_target = argv[++a];
+        else if (a + 1 < argc && arg == "--metrics-format" && parseMetricsFormat(argv[a + 1], metrics_format))
+            ++a;
+        else if (a + 1 < argc && arg == "--metrics-interval" && parseDouble(argv[a + 1], metrics_interval))
+        {
+            metrics_interval = max(0.1, metrics_interval);
+            a++;
+        }
+        else
         {
-            max_value = output[i];
-            max_index = i;
+            usage(argv[0]);
+            return 1;
         }
     }
-    return max_index;
-}
 
-int main()
-{
     // 加载模型
     Layer inputToHidden, hiddenToOutput;
-    if (!loadModel(inputToHidden, hiddenToOutput, "model.bin"))
+    ModelInfo model_info;
+    if (!loadModel(inputToHidden, hiddenToOutput, model_path, &model_info) ||
+        !applyModelPreprocess(model_info, preprocess, model_path))
     {
         return 1;
     }
 
-    // 读取测试图像
-    string image_path = "test.bmp";
+    PredictionCache cache(cache_capacity);
 
-    vector<uint8_t> pixels;
-    vector<float> pixelData;
+    if (cache_capacity)
+    {
+        metrics().gaugeFunction("digits_cache_hits", "Prediction cache hits", [&cache]
+                                { return (double)cache.hits(); });
+        metrics().gaugeFunction("digits_cache_misses", "Prediction cache misses", [&cache]
+                                { return (double)cache.misses(); });
+        metrics().gaugeFunction("digits_cache_evictions", "Prediction cache evictions", [&cache]
+                                { return (double)cache.evictions(); });
+    }
+    unique_ptr<MetricsReporter> reporter;
+    if (!metrics_target.empty())
+        reporter.reset(new MetricsReporter(metrics_target, metrics_format, metrics_interval));
+
+    if (!multi_path.empty())
+        return runMulti(multi_path, segment_method, preprocess, batch, inputToHidden, hiddenToOutput);
 
+    if (!stream_path.empty())
+    {
+        int fd = stream_path == "-" ? STDIN_FILENO : open(stream_path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            cerr << "Error: Could not open " << stream_path << ": " << strerror(errno) << endl;
+            return 1;
+        }
+        int rc = runStream(fd, bmp_input, binary_output, batch, preprocess, inputToHidden, hiddenToOutput,
+                           cache, cache_capacity > 0);
+        if (fd != STDIN_FILENO)
+            close(fd);
+        if (cache_capacity)
+            cerr << "Cache: " << cache.hits() << " hits, " << cache.misses() << " misses, hit rate "
+                 << cache.hitRate() * 100 << "%" << endl;
+        return rc;
+    }
+
+    // 待识别的图片
+    vector<string> paths;
     for (int i = 0; i < 10; i++)
     {
         for (int j = 1; j <= 500; j++)
-        {
-            string s = to_string(j);
-            string path = "../public/train_bmp/" + to_string(i) + "/" +
-                          to_string(i) + "_" + s + ".bmp";
+            paths.push_back("../public/train_bmp/" + to_string(i) + "/" + to_string(i) + "_" + to_string(j) + ".bmp");
+    }
 
-            pixels.clear();
-            pixelData.clear();
-            if (!readBMP(path, pixels))
-            {
-                continue;
-            }
-            for (auto pixel : pixels)
+    vector<float> pixelData;
+
+    Histogram &inference_seconds = metrics().histogram("digits_inference_seconds", "Forward pass time per image");
+    Counter &predictions = metrics().counter("digits_predictions_total", "Images classified");
+
+    // 读取协程按文件顺序把解码后的图片交给这里识别，识别期间其余文件的读取仍在进行
+    auto classify = [&](size_t, const vector<uint8_t> &pixels)
+    {
+        predictions.add();
+
+        // 命中缓存则直接输出，跳过前向传播
+        uint64_t key = 0;
+        if (cache_capacity)
+        {
+            CachedPrediction cached;
+            key = hashBytes(pixels.data(), pixels.size());
+            if (cache.lookup(pixels, key, cached))
             {
-                pixelData.push_back((float)pixel / 255.0f);
+                cout << "Predicted digit: " << cached.digit << endl;
+                return;
             }
-            // 进行预测
-            vector<float> output = forwardPropagation(pixelData, inputToHidden, hiddenToOutput);
-            int predicted_digit = getPredictedDigit(output);
-            // 输出结果
-            cout << "Predicted digit: " << predicted_digit << endl;
         }
+        pixelData.clear();
+        for (auto pixel : pixels)
+        {
+            pixelData.push_back((float)pixel / 255.0f);
+        }
+        if (preprocess)
+            preprocessDigit(pixelData.data(), pixelData.data());
+        // 进行预测
+        auto predict_start = chrono::steady_clock::now();
+        vector<float> output = predict(pixelData, inputToHidden, hiddenToOutput);
+        inference_seconds.observe(chrono::duration<double>(chrono::steady_clock::now() - predict_start).count());
+        int predicted_digit = getPredictedDigit(output);
+        if (cache_capacity)
+        {
+            CachedPrediction value;
+            value.digit = predicted_digit;
+            copy(output.begin(), output.end(), value.scores.begin());
+            cache.insert(pixels, key, value);
+        }
+        // 输出结果
+        cout << "Predicted digit: " << predicted_digit << endl;
+    };
+
+    auto start = chrono::steady_clock::now();
+    size_t images = 0;
+    for (int pass = 0; pass < passes; pass++)
+        images += loadBMPFiles(paths, classify, io_backend, io_depth);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "Classified " << images << " images in " << seconds << " s (" << images / seconds << " images/s)" << endl;
+    if (cache_capacity)
+    {
+        cerr << "Cache: " << cache.hits() << " hits, " << cache.misses() << " misses, "
+             << cache.evictions() << " evictions, hit rate " << cache.hitRate() * 100 << "%" << endl;
     }
 
     return 0;
@@ -0,0 +1,384 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+#include <climits>
+#include <cmath>
+#include <string>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+
+#include "core/args.h"
+#include "core/dataset.h"
+#include "core/model_io.h"
+#include "core/network.h"
+using namespace std;
+
+// 所有训练任务只读共享同一份样本
+struct Dataset
+{
+    vector<Sample> samples;
+    vector<uint32_t> train; // 训练集下标
+    vector<uint32_t> val;   // 验证集下标（每 5 张取 1 张）
+};
+
+// 一组超参数及其训练状态
+struct Trial
+{
+    int id = 0;
+    float learning_rate = 0.01f;
+    int hidden_size = 256;
+    Layer inputToHidden, hiddenToOutput;
+    int epochs_done = 0;
+    double val_accuracy = 0.0;
+    mt19937 gen;           // 每个 epoch 打乱训练顺序，按试验播种，结果可复现
+    int rung = -1;         // 已派发到的最高一轮
+    int stopped_rung = -1; // 在第几轮被淘汰，-1 表示跑完全部预算
+};
+
+void initTrial(Trial &trial, unsigned seed)
+{
+    mt19937 gen(seed);
+    uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    trial.inputToHidden.weights.resize((size_t)input_size * trial.hidden_size);
+    for (auto &w : trial.inputToHidden.weights)
+        w = dis(gen);
+    trial.inputToHidden.biases.assign(trial.hidden_size, 0.0f);
+    trial.hiddenToOutput.weights.resize((size_t)trial.hidden_size * output_size);
+    for (auto &w : trial.hiddenToOutput.weights)
+        w = dis(gen);
+    trial.hiddenToOutput.biases.assign(output_size, 0.0f);
+    trial.gen.seed(seed + 1);
+}
+
+double validate(const Trial &trial, const Dataset &data)
+{
+    int correct = 0;
+    for (uint32_t n : data.val)
+    {
+        const Sample &sample = data.samples[n];
+        if (getPredictedDigit(predict(sample.input, trial.inputToHidden, trial.hiddenToOutput)) == sample.label)
+            correct++;
+    }
+    return data.val.empty() ? 0.0 : (double)correct / data.val.size();
+}
+
+// 与 cv3 --shuffle 相同的 sigmoid + 均方误差 SGD，只是学习率取自试验。
+// 数据集按类别排列，不打乱时网络会一直被最近的类别拉偏，停在 10% 附近
+void trainEpochs(Trial &trial, const Dataset &data, int epochs)
+{
+    vector<uint32_t> order = data.train;
+    for (int e = 0; e < epochs; e++)
+    {
+        shuffle(order.begin(), order.end(), trial.gen);
+        for (uint32_t n : order)
+        {
+            const Sample &sample = data.samples[n];
+            auto fr = forwardPropagation(sample.input, trial.inputToHidden, trial.hiddenToOutput);
+            backwardPropagation(sample.input, fr, getTarget(sample.label),
+                                trial.inputToHidden, trial.hiddenToOutput, trial.learning_rate);
+        }
+        trial.epochs_done++;
+    }
+    trial.val_accuracy = validate(trial, data);
+}
+
+// 异步逐轮减半（ASHA）：各轮之间没有屏障。空闲线程先找可以提升的试验——
+// 某一轮已完成的试验中验证准确率排在前 1/eta、还没提升过的，继续训练到下一轮预算；
+// 没有就开始一个新试验（隐藏层大的先开始），都没有时等别的线程完成一个任务。
+// 这样最后几轮只剩一两个试验时，其余的核仍在跑较低轮次的试验。
+// 代价是提升依据的是当时已完成的结果，线程数或耗时不同，被淘汰的试验可能不同
+void runAsync(vector<Trial> &trials, const Dataset &data, const vector<int> &budgets, int eta, int jobs)
+{
+    vector<Trial *> pending;
+    for (auto &t : trials)
+        pending.push_back(&t);
+    stable_sort(pending.begin(), pending.end(), [](const Trial *a, const Trial *b)
+                { return a->hidden_size < b->hidden_size; });
+    // finished[k]：在第 k 轮完成的试验及其当时的验证准确率
+    vector<vector<pair<double, Trial *>>> finished(budgets.size());
+    int running = 0;
+    mutex mtx;
+    condition_variable changed;
+
+    // 持锁调用：取下一个任务并把试验标记到目标轮次，没有任务时返回 nullptr。
+    // 所有试验都不再运行后 drain 为真，此时每轮至少提升一个（同步减半的 max(1, n / eta)），
+    // 避免试验数不是 eta 的倍数时没有任何试验到达最后一轮
+    auto nextJob = [&](bool drain) -> Trial *
+    {
+        for (int k = (int)budgets.size() - 2; k >= 0; k--)
+        {
+            vector<pair<double, Trial *>> ranked = finished[k];
+            stable_sort(ranked.begin(), ranked.end(), [](const pair<double, Trial *> &a, const pair<double, Trial *> &b)
+                        { return a.first > b.first; });
+            size_t quota = ranked.size() / eta;
+            if (drain && !ranked.empty())
+                quota = max<size_t>(1, quota);
+            for (size_t i = 0; i < quota; i++)
+            {
+                if (ranked[i].second->rung == k)
+                {
+                    ranked[i].second->rung = k + 1;
+                    return ranked[i].second;
+                }
+            }
+        }
+        if (pending.empty())
+            return nullptr;
+        Trial *trial = pending.back();
+        pending.pop_back();
+        trial->rung = 0;
+        return trial;
+    };
+
+    vector<thread> workers;
+    for (int t = 0; t < min<int>(jobs, trials.size()); t++)
+    {
+        workers.emplace_back([&]()
+                             {
+            unique_lock<mutex> lock(mtx);
+            for (;;)
+            {
+                Trial *trial = nextJob(false);
+                if (!trial && running == 0)
+                    trial = nextJob(true);
+                if (!trial)
+                {
+                    if (running == 0)
+                        break;
+                    changed.wait(lock);
+                    continue;
+                }
+                running++;
+                int rung = trial->rung;
+                lock.unlock();
+                trainEpochs(*trial, data, budgets[rung] - trial->epochs_done);
+                lock.lock();
+                running--;
+                finished[rung].push_back({trial->val_accuracy, trial});
+                cout << "  rung " << rung << " trial " << trial->id << " (lr " << trial->learning_rate << ", hidden "
+                     << trial->hidden_size << ") epoch " << trial->epochs_done << ": val " << trial->val_accuracy * 100 << "%\n";
+                changed.notify_all();
+            }
+            changed.notify_all(); });
+    }
+    for (auto &w : workers)
+        w.join();
+
+    for (auto &t : trials)
+    {
+        if (t.rung < (int)budgets.size() - 1)
+            t.stopped_rung = t.rung;
+    }
+}
+
+// 逗号分隔的数值列表；任何一项不是合法数值时返回 false
+bool parseFloats(const string &list, vector<float> &values)
+{
+    vector<float> parsed;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ','))
+    {
+        float v;
+        if (!parseFloat(item.c_str(), v))
+            return false;
+        parsed.push_back(v);
+    }
+    values = move(parsed);
+    return true;
+}
+
+bool parseInts(const string &list, vector<int> &values)
+{
+    vector<float> parsed;
+    if (!parseFloats(list, parsed))
+        return false;
+    values.clear();
+    for (float v : parsed)
+        values.push_back(max(1, (int)min(v, (float)INT_MAX)));
+    return true;
+}
+
+void usage(const char *prog)
+{
+    cerr << "Usage: " << prog << " [--lr 0.005,0.01,0.05] [--hidden 32,64,128,256] [--epochs 40]\n"
+         << "       [--random N] [--eta 3] [--min-epochs 5] [--jobs N] [--seed 1]\n"
+         << "       [--data ../public/train_bmp] [--results sweep.csv] [--out best_model.bin] [--preprocess]\n";
+}
+
+int main(int argc, char **argv)
+{
+    vector<float> lrs = {0.005f, 0.01f, 0.05f};
+    vector<int> hiddens = {32, 64, 128, 256};
+    int max_epochs = 40;
+    int random_trials = 0; // 大于 0 时随机搜索，否则网格搜索
+    int eta = 3;           // 每轮保留 1/eta
+    int min_epochs = 5;    // 第一轮的训练预算
+    int jobs = max(1u, thread::hardware_concurrency());
+    unsigned seed = 1;
+    string data_root = "../public/train_bmp";
+    string results_path = "sweep.csv";
+    string out_path = "best_model.bin";
+    bool preprocess = false;
+    for (int a = 1; a < argc; ++a)
+    {
+        string arg = argv[a];
+        if (arg == "--preprocess")
+        {
+            preprocess = true;
+            continue;
+        }
+        if (a + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        if (arg == "--lr" && parseFloats(argv[a + 1], lrs))
+            a++;
+        else if (arg == "--hidden" && parseInts(argv[a + 1], hiddens))
+            a++;
+        else if (arg == "--epochs" && parseInt(argv[a + 1], max_epochs))
+        {
+            max_epochs = max(1, max_epochs);
+            a++;
+        }
+        else if (arg == "--random" && parseInt(argv[a + 1], random_trials))
+            a++;
+        else if (arg == "--eta" && parseInt(argv[a + 1], eta))
+        {
+            eta = max(2, eta);
+            a++;
+        }
+        else if (arg == "--min-epochs" && parseInt(argv[a + 1], min_epochs))
+        {
+            min_epochs = max(1, min_epochs);
+            a++;
+        }
+        else if (arg == "--jobs" && parseInt(argv[a + 1], jobs))
+        {
+            jobs = max(1, jobs);
+            a++;
+        }
+        else if (arg == "--seed" && parseUnsigned(argv[a + 1], seed))
+            a++;
+        else if (arg == "--data")
+            data_root = argv[++a];
+        else if (arg == "--results")
+            results_path = argv[++a];
+        else if (arg == "--out")
+            out_path = argv[++a];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (lrs.empty() || hiddens.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 1) 只读一次数据集，所有任务共享
+    Dataset data;
+    loadDataset(data_root, 500, data.samples);
+    if (preprocess)
+        preprocessDataset(data.samples);
+    for (uint32_t n = 0; n < data.samples.size(); n++)
+        (n % 5 == 4 ? data.val : data.train).push_back(n);
+    if (data.train.empty() || data.val.empty())
+    {
+        cerr << "Error: Not enough samples loaded." << endl;
+        return 1;
+    }
+    cout << "Loaded " << data.samples.size() << " samples (" << data.train.size() << " train, "
+         << data.val.size() << " validation)\n";
+
+    // 2) 生成试验：网格或随机搜索（学习率在给定范围内按对数均匀采样）
+    vector<Trial> trials;
+    mt19937 gen(seed);
+    if (random_trials > 0)
+    {
+        auto lr_range = minmax_element(lrs.begin(), lrs.end());
+        uniform_real_distribution<float> log_lr(log(*lr_range.first), log(*lr_range.second));
+        uniform_int_distribution<size_t> pick_hidden(0, hiddens.size() - 1);
+        for (int k = 0; k < random_trials; k++)
+        {
+            Trial t;
+            t.learning_rate = exp(log_lr(gen));
+            t.hidden_size = hiddens[pick_hidden(gen)];
+            trials.push_back(move(t));
+        }
+    }
+    else
+    {
+        for (float lr : lrs)
+        {
+            for (int hs : hiddens)
+            {
+                Trial t;
+                t.learning_rate = lr;
+                t.hidden_size = hs;
+                trials.push_back(move(t));
+            }
+        }
+    }
+    for (size_t k = 0; k < trials.size(); k++)
+    {
+        trials[k].id = k;
+        initTrial(trials[k], seed + 1000 * (k + 1));
+    }
+
+    // 3) 逐轮减半：第 k 轮的预算为 min-epochs * eta^k（不超过最大 epoch 数），
+    //    每轮只有前 1/eta 的试验继续训练，调度见 runAsync
+    vector<int> budgets = {min(min_epochs, max_epochs)};
+    while (budgets.back() < max_epochs)
+        budgets.push_back(min(max_epochs, budgets.back() * eta));
+    cout << "Rung budgets (epochs):";
+    for (int b : budgets)
+        cout << " " << b;
+    cout << "\n";
+    auto start = chrono::steady_clock::now();
+    runAsync(trials, data, budgets, eta, jobs);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // 4) 结果表
+    vector<Trial *> ranked;
+    for (auto &t : trials)
+        ranked.push_back(&t);
+    sort(ranked.begin(), ranked.end(), [](const Trial *a, const Trial *b)
+         {
+        if (a->epochs_done != b->epochs_done)
+            return a->epochs_done > b->epochs_done;
+        return a->val_accuracy > b->val_accuracy; });
+
+    ofstream csv(results_path);
+    csv << "id,learning_rate,hidden_size,epochs,val_accuracy,stopped_rung\n";
+    cout << "\n  id        lr  hidden  epochs  val_acc  status\n";
+    for (const Trial *t : ranked)
+    {
+        csv << t->id << "," << t->learning_rate << "," << t->hidden_size << "," << t->epochs_done << ","
+            << t->val_accuracy << "," << t->stopped_rung << "\n";
+        cout << setw(4) << t->id << setw(10) << t->learning_rate << setw(8) << t->hidden_size << setw(8)
+             << t->epochs_done << setw(8) << fixed << setprecision(2) << t->val_accuracy * 100 << "%  "
+             << (t->stopped_rung < 0 ? string("finished") : "stopped at rung " + to_string(t->stopped_rung))
+             << "\n";
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+    }
+    cout << "Sweep took " << seconds << " s with " << jobs << " worker threads; results written to "
+         << results_path << "\n";
+
+    const Trial *best = ranked.front();
+    cout << "Best: trial " << best->id << " (lr " << best->learning_rate << ", hidden " << best->hidden_size
+         << ", " << best->epochs_done << " epochs, val " << best->val_accuracy * 100 << "%)\n";
+    saveModel(best->inputToHidden, best->hiddenToOutput, out_path, preprocess ? model_flag_preprocess : 0);
+    return 0;
+}
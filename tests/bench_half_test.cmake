@@ -0,0 +1,19 @@
+# 回归测试：bench 对半精度模型（cv3 --export-half）要跑完包括训练一步在内的所有测量，不能崩溃。
+# 用法：cmake -DCV3=<cv3> -DBENCH=<bench> -DDATA=<训练集目录> -DWORK=<临时目录> -P bench_half_test.cmake
+
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+foreach(precision bf16 fp16)
+  execute_process(COMMAND ${CV3} --data ${DATA} --epochs 1 --hidden 8 --seed 3 --precision ${precision}
+                          --checkpoint ${WORK}/checkpoint.bin --out ${WORK}/model.bin --export-half ${WORK}/${precision}.bin
+                  RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE error)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "cv3 --precision ${precision} failed: ${error}")
+  endif()
+  execute_process(COMMAND ${BENCH} --model ${WORK}/${precision}.bin --data ${DATA} --per-class 5 --seconds 0.01
+                  RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE error)
+  if(NOT result EQUAL 0 OR NOT output MATCHES "train step")
+    message(FATAL_ERROR "bench on a ${precision} model failed (${result}): ${output}${error}")
+  endif()
+endforeach()
+message(STATUS "bench_half_test passed")
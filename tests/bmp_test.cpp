@@ -0,0 +1,148 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "core/async_io.h"
+#include "core/bmp.h"
+using namespace std;
+
+// 回归测试：parseBMP / readGrayBMP 遇到截断或偏移量被篡改的文件必须拒绝，不能越界读；
+// 异步批量读取遇到过大的文件不能一直加倍缓冲区读下去
+
+static int failures = 0;
+
+static void check(bool ok, const string &what)
+{
+    if (!ok)
+    {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+// 与训练样本相同的 28x28 8 位 BMP：头部 54 字节 + 256 色调色板 + 784 字节像素
+static vector<uint8_t> makeDigitBMP()
+{
+    const uint32_t offset = sizeof(BMPHeader) + sizeof(BMPInfoHeader) + 256 * 4;
+    vector<uint8_t> file(offset + 28 * 28);
+    BMPHeader header = {};
+    header.bfType[0] = 'B';
+    header.bfType[1] = 'M';
+    header.bfSize = file.size();
+    header.bfOffBits = offset;
+    BMPInfoHeader info = {};
+    info.biSize = sizeof(info);
+    info.biWidth = 28;
+    info.biHeight = 28;
+    info.biPlanes = 1;
+    info.biBitCount = 8;
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), &info, sizeof(info));
+    for (int i = 0; i < 256; i++)
+        memset(file.data() + sizeof(header) + sizeof(info) + 4 * i, i, 3);
+    for (int i = 0; i < 28 * 28; i++)
+        file[offset + i] = (uint8_t)i;
+    return file;
+}
+
+static void setOffset(vector<uint8_t> &file, uint32_t offset)
+{
+    memcpy(file.data() + offsetof(BMPHeader, bfOffBits), &offset, sizeof(offset));
+}
+
+static void setSize(vector<uint8_t> &file, uint32_t size)
+{
+    memcpy(file.data() + offsetof(BMPHeader, bfSize), &size, sizeof(size));
+}
+
+static void testParseBMP()
+{
+    vector<uint8_t> pixels;
+    vector<uint8_t> good = makeDigitBMP();
+    check(parseBMP(good.data(), good.size(), pixels) == (long)good.size(), "valid file parses");
+    check(pixels.size() == 28 * 28 && pixels[0] == 0 && pixels[783] == (uint8_t)783, "valid file pixels");
+
+    // 数据不足：头部不完整或像素未到齐时返回 0，等待更多数据
+    check(parseBMP(good.data(), 20, pixels) == 0, "truncated header needs more data");
+    check(parseBMP(good.data(), good.size() - 1, pixels) == 0, "truncated pixels need more data");
+
+    // bfOffBits + 784 在 uint32 中回绕到 bfSize 以内
+    vector<uint8_t> wrap = good;
+    setOffset(wrap, 0xFFFFFD00u);
+    check(parseBMP(wrap.data(), wrap.size(), pixels) == -1, "wrapping bfOffBits is rejected");
+
+    vector<uint8_t> past_end = good;
+    setOffset(past_end, good.size() - 28 * 28 + 1);
+    check(parseBMP(past_end.data(), past_end.size(), pixels) == -1, "pixels past bfSize are rejected");
+
+    vector<uint8_t> inside_header = good;
+    setOffset(inside_header, 10);
+    check(parseBMP(inside_header.data(), inside_header.size(), pixels) == -1, "bfOffBits inside the header is rejected");
+
+    vector<uint8_t> short_size = good;
+    setSize(short_size, 100);
+    check(parseBMP(short_size.data(), short_size.size(), pixels) == -1, "bfSize smaller than the pixel area is rejected");
+}
+
+static bool writeFile(const string &path, const vector<uint8_t> &data)
+{
+    ofstream outFile(path, ios::binary);
+    outFile.write(reinterpret_cast<const char *>(data.data()), data.size());
+    return (bool)outFile;
+}
+
+static void testReadGrayBMP()
+{
+    const string path = "bmp_test_tmp.bmp";
+    GrayImage image;
+    vector<uint8_t> good = makeDigitBMP();
+
+    vector<uint8_t> wrap = good;
+    setOffset(wrap, 0xFFFFFD00u);
+    check(writeFile(path, wrap) && !readGrayBMP(path, image), "readGrayBMP rejects a wrapping offset");
+
+    vector<uint8_t> truncated(good.begin(), good.end() - 100);
+    check(writeFile(path, truncated) && !readGrayBMP(path, image), "readGrayBMP rejects a truncated file");
+
+    check(writeFile(path, good) && readGrayBMP(path, image) && image.width == 28 && image.height == 28,
+          "readGrayBMP reads a valid file");
+    remove(path.c_str());
+}
+
+// 第二个文件是后面拼了 1 MB 的合法图片：应被拒绝、不交给 consume，前后两个正常文件照常交付
+static void testLoadOversized(IoBackend backend)
+{
+    const string good_path = "bmp_test_tmp_good.bmp", large_path = "bmp_test_tmp_large.bmp";
+    vector<uint8_t> good = makeDigitBMP();
+    vector<uint8_t> large = good;
+    large.resize(good.size() + (1 << 20));
+    check(writeFile(good_path, good) && writeFile(large_path, large), "write oversized test files");
+
+    vector<string> paths = {good_path, large_path, good_path};
+    vector<size_t> sizes(paths.size(), 0);
+    size_t decoded = loadBMPFiles(paths, [&](size_t index, const vector<uint8_t> &pixels)
+                                  { sizes[index] = pixels.size(); },
+                                  backend, 2);
+    check(decoded == 2 && sizes[0] == 28 * 28 && sizes[1] == 0 && sizes[2] == 28 * 28, "loadBMPFiles rejects an oversized file");
+    remove(good_path.c_str());
+    remove(large_path.c_str());
+}
+
+int main()
+{
+    testParseBMP();
+    testReadGrayBMP();
+    testLoadOversized(IoBackend::Threads);
+    testLoadOversized(IoBackend::Auto);
+    if (failures)
+    {
+        cerr << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "bmp_test passed" << endl;
+    return 0;
+}
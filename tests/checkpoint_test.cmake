@@ -0,0 +1,35 @@
+# 回归测试：检查点不能改变训练结果。同一种子的 bf16 训练，写检查点与不写检查点得到逐字节相同的模型，
+# 从 epoch 中途的检查点续训也得到同样的模型；设置与检查点不一致时拒绝续训。
+# 用法：cmake -DCV3=<cv3> -DDATA=<训练集目录> -DWORK=<临时目录> -P checkpoint_test.cmake
+
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+set(common --data ${DATA} --epochs 3 --hidden 8 --seed 7 --shuffle --precision bf16 --half-refresh 7)
+
+function(train expect_ok)
+  execute_process(COMMAND ${CV3} ${common} ${ARGN} WORKING_DIRECTORY ${WORK}
+                  RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE error)
+  if(expect_ok AND NOT result EQUAL 0)
+    message(FATAL_ERROR "cv3 ${ARGN} failed: ${error}")
+  elseif(NOT expect_ok AND result EQUAL 0)
+    message(FATAL_ERROR "cv3 ${ARGN} should have been refused")
+  endif()
+endfunction()
+
+function(expect_same a b what)
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK}/${a} ${WORK}/${b} RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${what}: ${a} and ${b} differ")
+  endif()
+endfunction()
+
+train(TRUE --checkpoint none.ck --out plain.bin)
+# 每个 epoch 末尾与每 1 毫秒各写一次检查点，epoch 中途也会写
+train(TRUE --checkpoint every.ck --checkpoint-every 1 --checkpoint-secs 0.001 --out checkpointed.bin)
+expect_same(plain.bin checkpointed.bin "checkpoints change bf16 training")
+train(TRUE --checkpoint every.ck --resume --out resumed.bin)
+expect_same(plain.bin resumed.bin "resumed bf16 training differs from the uninterrupted run")
+
+set(common --data ${DATA} --epochs 3 --hidden 8 --precision bf16 --half-refresh 7)
+train(FALSE --checkpoint every.ck --resume --out refused.bin)
+message(STATUS "checkpoint_test passed")
@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "core/model_io.h"
+using namespace std;
+
+// 回归测试：loadModel 遇到层尺寸被篡改或被截断的模型文件必须拒绝，且不能按文件里的尺寸分配内存；
+// "DGMF" 头中的预处理标志能读回，没有头的旧文件照常读取
+
+static int failures = 0;
+
+static void check(bool ok, const string &what)
+{
+    if (!ok)
+    {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+static vector<char> readFile(const string &path)
+{
+    ifstream inFile(path, ios::binary);
+    return vector<char>(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+}
+
+static bool writeFile(const string &path, const vector<char> &data)
+{
+    ofstream outFile(path, ios::binary);
+    outFile.write(data.data(), data.size());
+    return (bool)outFile;
+}
+
+static void setWord(vector<char> &file, size_t offset, uint32_t value)
+{
+    memcpy(file.data() + offset, &value, sizeof(value));
+}
+
+int main()
+{
+    const string path = "model_io_test_tmp.bin";
+    const int hidden = 8;
+    Layer inputToHidden, hiddenToOutput;
+    inputToHidden.weights.assign(input_size * hidden, 0.5f);
+    inputToHidden.biases.assign(hidden, 0.0f);
+    hiddenToOutput.weights.assign(hidden * output_size, 0.25f);
+    hiddenToOutput.biases.assign(output_size, 0.0f);
+    saveModel(inputToHidden, hiddenToOutput, path, model_flag_preprocess);
+    vector<char> good = readFile(path);
+    const size_t body = sizeof(model_flags_magic) + sizeof(uint32_t); // 第一层从标志头之后开始
+
+    Layer l1, l2;
+    ModelInfo info;
+    check(loadModel(l1, l2, path, &info) && l1.biases.size() == (size_t)hidden, "valid model loads");
+    check(info.has_flags && info.flags == model_flag_preprocess, "preprocess flag round-trips");
+    bool preprocess = false;
+    check(applyModelPreprocess(info, preprocess, path) && preprocess, "preprocess is enabled from the model");
+
+    saveModel(inputToHidden, hiddenToOutput, path);
+    check(loadModel(l1, l2, path, &info) && info.has_flags && info.flags == 0, "plain model records no preprocessing");
+    preprocess = true;
+    check(!applyModelPreprocess(info, preprocess, path), "--preprocess on a plain model is refused");
+
+    vector<char> legacy(good.begin() + body, good.end());
+    check(writeFile(path, legacy) && loadModel(l1, l2, path, &info) && !info.has_flags, "headerless model loads");
+    preprocess = true;
+    check(applyModelPreprocess(info, preprocess, path) && preprocess, "headerless model keeps the command line");
+
+    // 第一层权重数改成 4G 个：不能 resize，直接拒绝
+    vector<char> huge = good;
+    setWord(huge, body, 0xFFFFFFF0u);
+    check(writeFile(path, huge) && !loadModel(l1, l2, path), "huge weight count is rejected");
+
+    // 权重数与偏置数不匹配
+    vector<char> shape = good;
+    setWord(shape, body + 4, hidden + 1);
+    check(writeFile(path, shape) && !loadModel(l1, l2, path), "weights != fan_in * biases is rejected");
+
+    // 尺寸自洽但超过文件剩余长度
+    vector<char> large = good;
+    setWord(large, body, input_size * 60000u);
+    setWord(large, body + 4, 60000u);
+    check(writeFile(path, large) && !loadModel(l1, l2, path), "sizes past the end of the file are rejected");
+
+    vector<char> truncated(good.begin(), good.end() - 4);
+    check(writeFile(path, truncated) && !loadModel(l1, l2, path), "truncated model is rejected");
+
+    remove(path.c_str());
+    if (failures)
+    {
+        cerr << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "model_io_test passed" << endl;
+    return 0;
+}
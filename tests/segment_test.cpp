@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "core/dataset.h"
+#include "core/segment.h"
+using namespace std;
+
+// 回归测试：由训练图片合成的一行数字，切分后应得到同样个数的数字，且裁剪归一化后的 28x28 输入
+// 在某个平移候选（见 shiftedCopies）下与原图接近：原尺寸时大多逐像素一致，放大后只差重采样误差。
+// 参数为训练集目录
+
+static int failures = 0;
+
+static void check(bool ok, const string &what)
+{
+    if (!ok)
+    {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+// 裁出的数字的各平移候选与原图的平均绝对差，取最小者
+static double meanDifference(const float *digit, const float *original)
+{
+    vector<float> shifted(shift_count * 28 * 28);
+    shiftedCopies(digit, shifted.data());
+    double best = 1.0;
+    for (int c = 0; c < shift_count; c++)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < 28 * 28; i++)
+            sum += fabs(shifted[c * 28 * 28 + i] - original[i]);
+        best = min(best, sum / (28 * 28));
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " TRAIN_BMP_DIR" << endl;
+        return 1;
+    }
+    vector<Sample> dataset;
+    loadDataset(argv[1], 50, dataset);
+    check(dataset.size() == 500, "training images load");
+    if (dataset.empty())
+        return 1;
+
+    // 按放大倍数：平均差的上限与切错个数的图片比例上限。放大后笔画的断口变宽，
+    // 超过连通半径的断口会被切成两块，所以 2 倍时允许少量图片个数不对
+    const int length = 8;
+    const double max_difference[] = {0.01, 0.03};
+    const double max_miscounted[] = {0.0, 0.2};
+    for (int scale = 1; scale <= 2; scale++)
+    {
+        double worst = 0.0, total = 0.0;
+        int strips = 0, miscounted = 0, digits = 0;
+        for (size_t first = 0; first + length <= dataset.size(); first += length)
+        {
+            // 每隔几张取一张，使一行中的数字各不相同
+            vector<const float *> inputs;
+            for (int d = 0; d < length; d++)
+                inputs.push_back(dataset[(first + 53 * d) % dataset.size()].input.data());
+            GrayImage image = composeStrip(inputs, scale, 0);
+            Segmentation seg;
+            segmentDigits(image, SegmentMethod::Components, seg);
+            strips++;
+            if (seg.digits.size() != (size_t)length)
+            {
+                miscounted++;
+                continue;
+            }
+            vector<float> x(28 * 28);
+            for (int d = 0; d < length; d++)
+            {
+                extractDigit(image, seg, d, x.data());
+                double diff = meanDifference(x.data(), inputs[d]);
+                worst = max(worst, diff);
+                total += diff;
+                digits++;
+            }
+        }
+        cout << "scale " << scale << ": " << strips << " strips, " << miscounted << " miscounted, mean difference "
+             << (digits ? total / digits : 0.0) << ", worst " << worst << endl;
+        check(miscounted <= max_miscounted[scale - 1] * strips, "scale " + to_string(scale) + ": strips split into the right number of digits");
+        check(digits > 0 && total / digits <= max_difference[scale - 1], "scale " + to_string(scale) + ": segmented digits match the originals");
+    }
+
+    if (failures)
+    {
+        cerr << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "segment_test passed" << endl;
+    return 0;
+}